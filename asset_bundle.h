@@ -0,0 +1,146 @@
+// Pre-decoded asset bundle written by asset_pack. Textures are stored as raw
+// RGBA, ready for glTexImage2D, so loading is an mmap() and an upload with no
+// PNG inflate or resize at startup.
+//
+// File layout, in the packing machine's byte order (the magic reads back
+// scrambled on a machine of the other order, and the loader rejects it):
+//   BundleHeader
+//   BundleTexture[textureCount]
+//   BundleSprite[spriteCount]
+//   pixel data; every mip level starts on a BUNDLE_ALIGN boundary
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint32_t BUNDLE_MAGIC = 0x4e424143; // "CABN" read as a little-endian word.
+const uint32_t BUNDLE_VERSION = 2;
+const int BUNDLE_NAME_SIZE = 24;
+const int BUNDLE_MAX_LEVELS = 16;
+const int BUNDLE_ALIGN = 64;
+
+struct BundleHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t textureCount;
+    uint32_t spriteCount;
+};
+
+// Level i is max(1, width >> i) x max(1, height >> i) RGBA pixels, top row first.
+struct BundleTexture {
+    char name[BUNDLE_NAME_SIZE];
+    uint32_t width, height;
+    uint32_t levels;
+    uint32_t reserved;
+    uint64_t offset[BUNDLE_MAX_LEVELS]; // From the start of the file.
+};
+
+// A named rectangle of a texture, in pixels of level 0.
+struct BundleSprite {
+    char name[BUNDLE_NAME_SIZE];
+    uint32_t texture;
+    int32_t x, y, width, height;
+};
+
+inline uint32_t bundleLevelWidth(const BundleTexture& t, int level) {
+    return t.width >> level ? t.width >> level : 1;
+}
+
+inline uint32_t bundleLevelHeight(const BundleTexture& t, int level) {
+    return t.height >> level ? t.height >> level : 1;
+}
+
+inline uint64_t bundleLevelSize(const BundleTexture& t, int level) {
+    return uint64_t(bundleLevelWidth(t, level)) * bundleLevelHeight(t, level) * 4;
+}
+
+// A mapped bundle; the pointers are valid until bundleClose().
+struct AssetBundle {
+    void* data = nullptr;
+    size_t size = 0;
+    const BundleHeader* header = nullptr;
+    const BundleTexture* textures = nullptr;
+    const BundleSprite* sprites = nullptr;
+};
+
+inline void bundleClose(AssetBundle& bundle) {
+    if (bundle.data)
+        munmap(bundle.data, bundle.size);
+    bundle = AssetBundle();
+}
+
+// Maps filename and checks that every table and level lies inside it. Returns
+// false quietly if the file does not exist, and with a message if it is bad.
+inline bool bundleOpen(const char* filename, AssetBundle& bundle) {
+    bundleClose(bundle);
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(BundleHeader))) {
+        close(fd);
+        std::cerr << "Bad asset bundle: " << filename << std::endl;
+        return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map asset bundle: " << filename << std::endl;
+        return false;
+    }
+    bundle.data = data;
+    bundle.size = st.st_size;
+    bundle.header = static_cast<const BundleHeader*>(data);
+    const BundleHeader& h = *bundle.header;
+    bool ok = h.magic == BUNDLE_MAGIC && h.version == BUNDLE_VERSION;
+    uint64_t tablesEnd = sizeof(BundleHeader) + uint64_t(h.textureCount) * sizeof(BundleTexture) +
+                         uint64_t(h.spriteCount) * sizeof(BundleSprite);
+    ok = ok && tablesEnd <= bundle.size;
+    if (ok) {
+        bundle.textures = reinterpret_cast<const BundleTexture*>(bundle.header + 1);
+        bundle.sprites = reinterpret_cast<const BundleSprite*>(bundle.textures + h.textureCount);
+        for (uint32_t i = 0; ok && i < h.textureCount; i++) {
+            const BundleTexture& t = bundle.textures[i];
+            ok = t.levels >= 1 && t.levels <= BUNDLE_MAX_LEVELS;
+            for (uint32_t l = 0; ok && l < t.levels; l++)
+                ok = t.offset[l] >= tablesEnd && t.offset[l] + bundleLevelSize(t, l) <= bundle.size;
+        }
+        for (uint32_t i = 0; ok && i < h.spriteCount; i++)
+            ok = bundle.sprites[i].texture < h.textureCount;
+    }
+    if (!ok) {
+        std::cerr << "Bad asset bundle: " << filename << std::endl;
+        bundleClose(bundle);
+        return false;
+    }
+    return true;
+}
+
+inline const BundleTexture* bundleTexture(const AssetBundle& bundle, const char* name) {
+    for (uint32_t i = 0; i < bundle.header->textureCount; i++) {
+        if (strncmp(bundle.textures[i].name, name, BUNDLE_NAME_SIZE) == 0)
+            return &bundle.textures[i];
+    }
+    return nullptr;
+}
+
+inline const BundleSprite* bundleSprite(const AssetBundle& bundle, const char* name) {
+    for (uint32_t i = 0; i < bundle.header->spriteCount; i++) {
+        if (strncmp(bundle.sprites[i].name, name, BUNDLE_NAME_SIZE) == 0)
+            return &bundle.sprites[i];
+    }
+    return nullptr;
+}
+
+inline const uint8_t* bundlePixels(const AssetBundle& bundle, const BundleTexture& t, int level) {
+    return static_cast<const uint8_t*>(bundle.data) + t.offset[level];
+}
+
+#endif
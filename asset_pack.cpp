@@ -0,0 +1,136 @@
+// Offline asset packer. Decodes, trims and shrinks the sprite PNGs and packs
+// them into the sprite atlas exactly as the game would at startup
+// (texture_atlas.h), then writes the atlas and its mip chain as raw RGBA into
+// one bundle that the game maps instead (asset_bundle.h).
+//
+// Build: g++ -O2 -std=c++17 asset_pack.cpp -o asset_pack
+// Usage: asset_pack [--out FILE] [--bench N]
+//
+// --bench N times N loads of the atlas from the PNGs and N from the written
+// bundle (map, validate and touch every cache line, as the upload would), which is
+// the part of the game's startup the bundle replaces.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "texture_atlas.h"
+#include "asset_bundle.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <chrono>
+
+// Writes the atlas and its mip chain as a one-texture bundle.
+bool writeBundle(const char* filename, const AtlasImage& atlas) {
+    const std::vector<RgbaImage>& mips = atlas.mips;
+    if (mips.size() + 1 > BUNDLE_MAX_LEVELS)
+        return false;
+    BundleHeader header = {BUNDLE_MAGIC, BUNDLE_VERSION, 1, SPRITE_COUNT};
+    BundleTexture texture = {};
+    strncpy(texture.name, "atlas", BUNDLE_NAME_SIZE - 1);
+    texture.width = atlas.width;
+    texture.height = atlas.height;
+    texture.levels = 1 + mips.size();
+
+    const uint8_t* levelPixels[BUNDLE_MAX_LEVELS];
+    uint64_t offset = sizeof(header) + sizeof(texture) + SPRITE_COUNT * sizeof(BundleSprite);
+    for (uint32_t l = 0; l < texture.levels; l++) {
+        offset = (offset + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+        texture.offset[l] = offset;
+        offset += bundleLevelSize(texture, l);
+        levelPixels[l] = l == 0 ? atlas.pixels.data() : mips[l - 1].pixels.data();
+    }
+
+    // Written beside the target and renamed over it once complete, and every
+    // write is checked: a short one (a full disk, say) must neither report
+    // success nor leave a truncated bundle where the game will map it.
+    std::string temp = std::string(filename) + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(&texture, sizeof(texture), 1, file) == 1;
+    for (int i = 0; ok && i < SPRITE_COUNT; i++) {
+        const AtlasRegion& r = atlas.regions[i];
+        BundleSprite sprite = {};
+        strncpy(sprite.name, spriteFiles[i], BUNDLE_NAME_SIZE - 1);
+        sprite.texture = 0;
+        sprite.x = r.x;
+        sprite.y = r.y;
+        sprite.width = r.width;
+        sprite.height = r.height;
+        ok = fwrite(&sprite, sizeof(sprite), 1, file) == 1;
+    }
+    static const char zeros[BUNDLE_ALIGN] = {};
+    for (uint32_t l = 0; ok && l < texture.levels; l++) {
+        long pad = static_cast<long>(texture.offset[l]) - ftell(file);
+        size_t size = bundleLevelSize(texture, l);
+        ok = pad >= 0 && pad < BUNDLE_ALIGN && fwrite(zeros, 1, pad, file) == static_cast<size_t>(pad) &&
+             fwrite(levelPixels[l], 1, size, file) == size;
+    }
+    ok = fclose(file) == 0 && ok;
+    if (ok && rename(temp.c_str(), filename) == 0)
+        return true;
+    remove(temp.c_str());
+    return false;
+}
+
+int main(int argc, char** argv) {
+    const char* outFile = "assets.bundle";
+    int benchRuns = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outFile = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            benchRuns = atoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    AtlasImage atlas;
+    if (!buildAtlas(atlas))
+        return 1;
+    if (!writeBundle(outFile, atlas)) {
+        std::cerr << "Failed to write bundle: " << outFile << std::endl;
+        return 1;
+    }
+    AssetBundle bundle;
+    if (!bundleOpen(outFile, bundle))
+        return 1;
+    printf("Wrote %s: %dx%d atlas, %d sprites, %d levels, %zu bytes\n", outFile, atlas.width, atlas.height,
+           SPRITE_COUNT, bundle.textures[0].levels, bundle.size);
+    bundleClose(bundle);
+    printAtlasMemory(atlas);
+
+    if (benchRuns > 0) {
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+        for (int run = 0; run < benchRuns; run++) {
+            AtlasImage decoded;
+            buildAtlas(decoded);
+        }
+        double pngMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / benchRuns;
+
+        unsigned long long checksum = 0;
+        start = Clock::now();
+        for (int run = 0; run < benchRuns; run++) {
+            bundleOpen(outFile, bundle);
+            const BundleTexture& t = bundle.textures[0];
+            for (uint32_t l = 0; l < t.levels; l++) {
+                const uint8_t* p = bundlePixels(bundle, t, l);
+                for (uint64_t b = 0; b < bundleLevelSize(t, l); b += 64)
+                    checksum += p[b];
+            }
+            bundleClose(bundle);
+        }
+        double bundleMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / benchRuns;
+        printf("Atlas load over %d runs: PNGs %.2f ms, bundle %.3f ms (%.0fx faster; checksum %llu)\n",
+               benchRuns, pngMs, bundleMs, bundleMs > 0 ? pngMs / bundleMs : 0.0, checksum);
+    }
+    return 0;
+}
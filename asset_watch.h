@@ -0,0 +1,136 @@
+// Watches the asset directory for changed files, for hot reload. A background
+// thread reads inotify events for files written or moved into the directory
+// (editors often save by renaming over the old file) and queues their names.
+// The game collects them with assetWatchTake() at a frame boundary.
+//
+// A file is handed out only after ASSET_WATCH_SETTLE_MS without further
+// events, so a tool still writing in several steps is not caught halfway.
+// inotify is Linux-only; elsewhere assetWatchStart() reports failure.
+#ifndef ASSET_WATCH_H
+#define ASSET_WATCH_H
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+const int ASSET_WATCH_SETTLE_MS = 150;
+const int ASSET_WATCH_POLL_MS = 100; // How often the thread checks for stop.
+
+struct AssetWatcher {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+    std::mutex mutex; // Guards changed.
+    // Changed file names, each with the time of its latest event.
+    std::vector<std::pair<std::string, std::chrono::steady_clock::time_point>> changed;
+};
+
+inline bool assetWatchRunning(const AssetWatcher& watcher) {
+    return watcher.fd >= 0;
+}
+
+#ifdef __linux__
+inline void assetWatchRun(AssetWatcher& watcher) {
+    alignas(inotify_event) char buffer[4096];
+    pollfd pfd = {watcher.fd, POLLIN, 0};
+    while (!watcher.stopping.load()) {
+        if (poll(&pfd, 1, ASSET_WATCH_POLL_MS) <= 0)
+            continue;
+        ssize_t length = read(watcher.fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            continue;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(watcher.mutex);
+        for (char* p = buffer; p < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->len == 0)
+                continue;
+            std::string name(event->name);
+            bool queued = false;
+            for (auto& entry : watcher.changed) {
+                if (entry.first == name) {
+                    entry.second = now;
+                    queued = true;
+                }
+            }
+            if (!queued)
+                watcher.changed.emplace_back(name, now);
+        }
+    }
+}
+#endif
+
+// Starts watching directory. False if inotify is unavailable.
+inline bool assetWatchStart(AssetWatcher& watcher, const char* directory) {
+#ifdef __linux__
+    watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher.fd < 0 || inotify_add_watch(watcher.fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "Failed to watch " << directory << " for asset changes" << std::endl;
+        if (watcher.fd >= 0)
+            close(watcher.fd);
+        watcher.fd = -1;
+        return false;
+    }
+    watcher.stopping = false;
+    watcher.thread = std::thread([&watcher] { assetWatchRun(watcher); });
+    return true;
+#else
+    (void)directory;
+    std::cerr << "Asset hot reload needs inotify (Linux)" << std::endl;
+    return false;
+#endif
+}
+
+inline void assetWatchStop(AssetWatcher& watcher) {
+    if (!assetWatchRunning(watcher))
+        return;
+    watcher.stopping = true;
+    watcher.thread.join();
+#ifdef __linux__
+    close(watcher.fd);
+#endif
+    watcher.fd = -1;
+}
+
+// Whether assetWatchTake() would return anything, without taking it.
+inline bool assetWatchPending(AssetWatcher& watcher) {
+    std::chrono::steady_clock::time_point settled =
+        std::chrono::steady_clock::now() - std::chrono::milliseconds(ASSET_WATCH_SETTLE_MS);
+    std::lock_guard<std::mutex> lock(watcher.mutex);
+    for (const auto& entry : watcher.changed) {
+        if (entry.second <= settled)
+            return true;
+    }
+    return false;
+}
+
+// Names of files that changed and have since settled, each reported once.
+inline std::vector<std::string> assetWatchTake(AssetWatcher& watcher) {
+    std::vector<std::string> names;
+    std::chrono::steady_clock::time_point settled =
+        std::chrono::steady_clock::now() - std::chrono::milliseconds(ASSET_WATCH_SETTLE_MS);
+    std::lock_guard<std::mutex> lock(watcher.mutex);
+    for (size_t i = 0; i < watcher.changed.size();) {
+        if (watcher.changed[i].second <= settled) {
+            names.push_back(watcher.changed[i].first);
+            watcher.changed.erase(watcher.changed.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    return names;
+}
+
+#endif
@@ -0,0 +1,289 @@
+// Opening the audio device, with a choice of buffer size, and measuring what
+// was actually delivered.
+//
+// - Latency profiles pick the SDL_mixer buffer: smaller reacts sooner,
+//   larger wakes the CPU less often and survives a slow frame.
+// - With no usable sound device, or when asked, SDL's "dummy" driver is used
+//   instead: the mixer still runs in real time, the output is discarded.
+// - audioOutputMonitor() adds a post effect that times the mixer callbacks
+//   and can copy the final mix to a WAV file. The timing also gives the
+//   output latency: how far the audio just mixed runs ahead of the device
+//   pulling it, which is the wait before it is played. The copy goes through a
+//   single-producer, single-consumer ring to a writer thread, so the audio
+//   thread never touches the disk; if the writer falls a whole ring behind,
+//   the bytes that did not fit are dropped and counted.
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+enum AudioProfile {
+    AUDIO_LOW_LATENCY,
+    AUDIO_BALANCED,
+    AUDIO_POWER_SAVE,
+    AUDIO_PROFILE_COUNT
+};
+
+struct AudioProfileInfo {
+    const char* name;
+    int bufferFrames;
+};
+
+const AudioProfileInfo AUDIO_PROFILES[AUDIO_PROFILE_COUNT] = {
+    {"low-latency", 256},
+    {"balanced", 1024},
+    {"power-save", 4096},
+};
+
+const int AUDIO_FREQUENCY = 44100;
+const char* const AUDIO_NULL_DRIVER = "dummy";
+const size_t AUDIO_DUMP_RING_BYTES = 1 << 20; // About 6 s of 44.1 kHz stereo; power of two.
+const int AUDIO_DUMP_FLUSH_MS = 100;
+const int AUDIO_WAV_HEADER_BYTES = 44;
+
+struct AudioDump {
+    FILE* file = nullptr;
+    std::vector<uint8_t> ring;
+    std::atomic<uint64_t> head{0}; // Advanced by the audio thread.
+    std::atomic<uint64_t> tail{0}; // Advanced by the writer.
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> recording{false}; // The audio thread pushes only while set.
+    std::atomic<bool> running{false};   // The writer drains only while set.
+    std::thread writer;
+    uint64_t written = 0; // Data bytes in the file.
+};
+
+struct AudioOutput {
+    AudioProfile profile = AUDIO_BALANCED;
+    const char* driver = "";
+    int frequency = 0, channels = 0;
+    Uint16 format = 0;
+    int bufferFrames = 0; // Requested from SDL_mixer.
+    // Callback timing, written by the audio thread.
+    std::atomic<int64_t> lastCallbackUs{0};
+    std::atomic<int> callbackFrames{0};
+    std::atomic<int> intervals{0}, lateCallbacks{0};
+    std::atomic<int64_t> totalIntervalUs{0}, worstIntervalUs{0};
+    // Output latency: frames mixed since the anchor, less the time since it,
+    // is what the device still has to play. Re-anchored after an underrun.
+    int64_t anchorUs = 0, anchorFrames = 0, framesMixed = 0;
+    std::atomic<int> latencySamples{0};
+    std::atomic<int64_t> totalLatencyUs{0}, worstLatencyUs{0};
+    AudioDump dump;
+};
+
+// Parses a profile name as given to --audio-latency.
+inline bool audioProfileFromName(const char* name, AudioProfile& profile) {
+    for (int i = 0; i < AUDIO_PROFILE_COUNT; i++) {
+        if (strcmp(name, AUDIO_PROFILES[i].name) == 0) {
+            profile = static_cast<AudioProfile>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Brings up SDL audio and SDL_mixer with driver, or SDL's default when null.
+inline bool audioOutputTryOpen(AudioOutput& output, const char* driver) {
+    if (driver)
+        SDL_setenv("SDL_AUDIODRIVER", driver, 1);
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        std::cerr << "SDL audio could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    if (Mix_OpenAudio(AUDIO_FREQUENCY, MIX_DEFAULT_FORMAT, 2, output.bufferFrames) < 0) {
+        std::cerr << "SDL_mixer could not initialize! SDL_mixer Error: " << Mix_GetError() << std::endl;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+    Mix_QuerySpec(&output.frequency, &output.format, &output.channels);
+    const char* name = SDL_GetCurrentAudioDriver();
+    output.driver = name ? name : "unknown";
+    return true;
+}
+
+// Opens audio with the profile's buffer size, falling back to the null
+// driver when there is no working device. False only if that fails too.
+inline bool audioOutputOpen(AudioOutput& output, AudioProfile profile, bool nullDriver) {
+    output.profile = profile;
+    output.bufferFrames = AUDIO_PROFILES[profile].bufferFrames;
+    if (!nullDriver) {
+        if (audioOutputTryOpen(output, nullptr))
+            return true;
+        std::cerr << "No usable sound device; continuing with the null audio driver." << std::endl;
+    }
+    return audioOutputTryOpen(output, AUDIO_NULL_DRIVER);
+}
+
+inline int64_t audioClockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void audioDumpPush(AudioDump& dump, const uint8_t* bytes, size_t length) {
+    uint64_t head = dump.head.load(std::memory_order_relaxed);
+    if (head - dump.tail.load(std::memory_order_acquire) + length > dump.ring.size()) {
+        dump.dropped.fetch_add(length, std::memory_order_relaxed);
+        return;
+    }
+    size_t at = head & (dump.ring.size() - 1);
+    size_t first = std::min(length, dump.ring.size() - at);
+    memcpy(dump.ring.data() + at, bytes, first);
+    memcpy(dump.ring.data(), bytes + first, length - first);
+    dump.head.store(head + length, std::memory_order_release);
+}
+
+// Writes whatever is in the ring to the file. Writer thread, or the caller
+// once the writer has stopped.
+inline void audioDumpDrain(AudioDump& dump) {
+    uint64_t tail = dump.tail.load(std::memory_order_relaxed);
+    uint64_t head = dump.head.load(std::memory_order_acquire);
+    while (tail != head) {
+        size_t at = tail & (dump.ring.size() - 1);
+        size_t count = std::min<uint64_t>(head - tail, dump.ring.size() - at);
+        dump.written += fwrite(dump.ring.data() + at, 1, count, dump.file);
+        tail += count;
+    }
+    dump.tail.store(tail, std::memory_order_release);
+}
+
+// Post effect: times each mixer callback and copies the mix to the dump.
+inline void audioOutputEffect(int, void* stream, int length, void* data) {
+    AudioOutput& output = *static_cast<AudioOutput*>(data);
+    int64_t now = audioClockUs();
+    int frames = length / (2 * output.channels);
+    output.callbackFrames.store(frames, std::memory_order_relaxed);
+    int64_t last = output.lastCallbackUs.exchange(now, std::memory_order_relaxed);
+    if (last) {
+        int64_t interval = now - last;
+        output.intervals++;
+        output.totalIntervalUs += interval;
+        if (interval > frames * int64_t(1500000) / output.frequency)
+            output.lateCallbacks++; // Half a buffer late: the device may have run dry.
+        int64_t worst = output.worstIntervalUs.load();
+        while (interval > worst && !output.worstIntervalUs.compare_exchange_weak(worst, interval)) {
+        }
+    }
+    if (!last || (output.framesMixed - output.anchorFrames) * int64_t(1000000) / output.frequency <
+                     now - output.anchorUs) {
+        // First callback, or the device ran dry and played silence: measure from here.
+        output.anchorUs = now;
+        output.anchorFrames = output.framesMixed;
+    }
+    output.framesMixed += frames;
+    int64_t latency = (output.framesMixed - output.anchorFrames) * int64_t(1000000) / output.frequency -
+                      (now - output.anchorUs);
+    output.latencySamples++;
+    output.totalLatencyUs += latency;
+    if (latency > output.worstLatencyUs.load(std::memory_order_relaxed))
+        output.worstLatencyUs.store(latency, std::memory_order_relaxed);
+    if (output.dump.recording.load(std::memory_order_acquire))
+        audioDumpPush(output.dump, static_cast<const uint8_t*>(stream), length);
+}
+
+inline void audioWriteLe(FILE* file, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        fputc((value >> (8 * i)) & 0xff, file);
+}
+
+inline void audioWriteWavHeader(FILE* file, int frequency, int channels, uint32_t dataBytes) {
+    fwrite("RIFF", 1, 4, file);
+    audioWriteLe(file, AUDIO_WAV_HEADER_BYTES - 8 + dataBytes, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    audioWriteLe(file, 16, 4);                        // fmt chunk size
+    audioWriteLe(file, 1, 2);                         // PCM
+    audioWriteLe(file, channels, 2);
+    audioWriteLe(file, frequency, 4);
+    audioWriteLe(file, frequency * channels * 2, 4);  // Bytes per second.
+    audioWriteLe(file, channels * 2, 2);              // Bytes per frame.
+    audioWriteLe(file, 16, 2);                        // Bits per sample.
+    fwrite("data", 1, 4, file);
+    audioWriteLe(file, dataBytes, 4);
+}
+
+// Call once audio is open and every other post effect is registered, so the
+// dump gets the final mix. dumpFile may be null for timing only. False if
+// the dump was asked for but cannot be written; timing works regardless.
+inline bool audioOutputMonitor(AudioOutput& output, const char* dumpFile) {
+    bool ok = true;
+    if (dumpFile && output.format != AUDIO_S16SYS) {
+        std::cerr << "Audio dump needs 16-bit output; not writing " << dumpFile << std::endl;
+        ok = false;
+    } else if (dumpFile) {
+        AudioDump& dump = output.dump;
+        dump.file = fopen(dumpFile, "wb");
+        if (!dump.file) {
+            std::cerr << "Could not open audio dump file: " << dumpFile << std::endl;
+            ok = false;
+        } else {
+            audioWriteWavHeader(dump.file, output.frequency, output.channels, 0);
+            dump.ring.resize(AUDIO_DUMP_RING_BYTES);
+            dump.running = true;
+            dump.writer = std::thread([&dump] {
+                while (dump.running.load(std::memory_order_relaxed)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_DUMP_FLUSH_MS));
+                    audioDumpDrain(dump);
+                }
+            });
+            dump.recording.store(true, std::memory_order_release);
+        }
+    }
+    Mix_RegisterEffect(MIX_CHANNEL_POST, audioOutputEffect, nullptr, &output);
+    return ok;
+}
+
+// Stops the writer and completes the WAV header. Call once the audio device
+// is closed, so that the final drain sees the whole mix.
+inline void audioOutputFinishDump(AudioOutput& output) {
+    AudioDump& dump = output.dump;
+    if (!dump.file)
+        return;
+    dump.recording = false;
+    dump.running = false;
+    if (dump.writer.joinable())
+        dump.writer.join();
+    audioDumpDrain(dump);
+    fseek(dump.file, 0, SEEK_SET);
+    audioWriteWavHeader(dump.file, output.frequency, output.channels, static_cast<uint32_t>(dump.written));
+    fclose(dump.file);
+    dump.file = nullptr;
+}
+
+// The output latency is measured from the callbacks: how much mixed audio
+// was queued ahead of the device's pull, averaged over every callback. It
+// covers the SDL buffers; a delay inside the driver or hardware after the
+// last pull is not visible to SDL and is not included. The engine sound
+// report (engine_sound.h) gives the measured key-to-audible latency.
+inline void audioOutputReport(const AudioOutput& output) {
+    int frames = output.callbackFrames.load();
+    if (frames == 0)
+        frames = output.bufferFrames;
+    printf("Audio output (%s driver, %s): %d frames at %d Hz, %.1f ms per buffer\n", output.driver,
+           AUDIO_PROFILES[output.profile].name, frames, output.frequency, frames * 1000.0 / output.frequency);
+    int samples = output.latencySamples.load();
+    if (samples > 0)
+        printf("Audio output latency (measured): %.1f ms mean, %.1f ms worst over %d callbacks\n",
+               output.totalLatencyUs.load() / 1000.0 / samples, output.worstLatencyUs.load() / 1000.0, samples);
+    int intervals = output.intervals.load();
+    if (intervals > 0)
+        printf("Audio callbacks (measured): every %.1f ms mean, %.1f ms worst, %d late over %d\n",
+               output.totalIntervalUs.load() / 1000.0 / intervals, output.worstIntervalUs.load() / 1000.0,
+               output.lateCallbacks.load(), intervals);
+    if (output.dump.written || output.dump.dropped.load())
+        printf("Audio dump: %.1f s written, %llu bytes dropped\n",
+               output.dump.written / (2.0 * output.channels * output.frequency),
+               static_cast<unsigned long long>(output.dump.dropped.load()));
+}
+
+#endif
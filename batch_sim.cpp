@@ -0,0 +1,249 @@
+// Batch simulator for difficulty tuning. Runs thousands of independent headless
+// games (game_sim.h) across all cores on a work-stealing pool, each driven by a
+// bot from sim_bots.h, and writes score, survival-time and collision-lane
+// distributions plus throughput as JSON or CSV.
+//
+// Build: g++ -O2 -std=c++17 -pthread batch_sim.cpp -o batch_sim
+// Usage: batch_sim [--games N] [--threads N] [--seed N] [--max-game-ticks N]
+//                  [--policy idle|random|dodge] [--steer-chance P] [--reach PX]
+//                  [--miss-chance P] [--reaction-ticks N] [--speed-ramp X] [--spawn-separation PX]
+//                  [--bins N] [--format json|csv] [--out FILE]
+//
+// The default bot is dodge, with the reaction delay every bot has by default
+// (BOT_REACTION_TICKS in sim_bots.h); --reaction-ticks 0 gives a perfect one.
+//
+// Game k is seeded with seed + k, so a report is reproducible for any thread count.
+
+#include "game_sim.h"
+#include "sim_bots.h"
+#include "work_pool.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+
+struct GameResult {
+    int score;
+    unsigned int ticks;
+    unsigned short laneCollisions[SIM_NUM_LANES];
+};
+
+struct Distribution {
+    double mean = 0;
+    double p50 = 0, p90 = 0, p99 = 0, max = 0;
+    double binWidth = 1;
+    std::vector<unsigned long long> bins;
+};
+
+// Summarises values (sorted in place) into percentiles and a histogram of binCount bins.
+Distribution summarise(std::vector<double>& values, int binCount) {
+    Distribution d;
+    if (values.empty())
+        return d;
+    std::sort(values.begin(), values.end());
+    double sum = 0;
+    for (double v : values)
+        sum += v;
+    d.mean = sum / values.size();
+    d.p50 = values[values.size() * 50 / 100];
+    d.p90 = values[values.size() * 90 / 100];
+    d.p99 = values[values.size() * 99 / 100];
+    d.max = values.back();
+    d.binWidth = d.max > 0 ? d.max / binCount : 1;
+    d.bins.assign(binCount, 0);
+    for (double v : values) {
+        int bin = static_cast<int>(v / d.binWidth);
+        d.bins[std::min(bin, binCount - 1)]++;
+    }
+    return d;
+}
+
+void writeDistributionJson(std::ostream& out, const char* name, const Distribution& d) {
+    char line[256];
+    snprintf(line, sizeof(line),
+             "  \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"bin_width\": %.3f, \"bins\": [",
+             name, d.mean, d.p50, d.p90, d.p99, d.max, d.binWidth);
+    out << line;
+    for (size_t i = 0; i < d.bins.size(); i++)
+        out << (i ? ", " : "") << d.bins[i];
+    out << "]},\n";
+}
+
+void writeDistributionCsv(std::ostream& out, const char* name, const Distribution& d) {
+    out << name << ",mean," << d.mean << "\n";
+    out << name << ",p50," << d.p50 << "\n";
+    out << name << ",p90," << d.p90 << "\n";
+    out << name << ",p99," << d.p99 << "\n";
+    out << name << ",max," << d.max << "\n";
+    for (size_t i = 0; i < d.bins.size(); i++)
+        out << name << ",bin_" << i * d.binWidth << "," << d.bins[i] << "\n";
+}
+
+int main(int argc, char** argv) {
+    unsigned long long gameCount = 10000;
+    unsigned threads = 0;
+    uint64_t seed = 1;
+    unsigned int maxGameTicks = 100000;
+    int binCount = 20;
+    BotConfig bot;
+    bot.policy = BOT_DODGE;
+    SimTuning tuning;
+    bool csv = false;
+    const char* outFile = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            gameCount = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--max-game-ticks") == 0 && i + 1 < argc) {
+            maxGameTicks = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            if (!botPolicyFromName(argv[++i], bot.policy)) {
+                std::cerr << "Unknown policy: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--steer-chance") == 0 && i + 1 < argc) {
+            bot.steerChance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--reach") == 0 && i + 1 < argc) {
+            bot.reach = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--miss-chance") == 0 && i + 1 < argc) {
+            bot.missChance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--reaction-ticks") == 0 && i + 1 < argc) {
+            bot.reactionTicks = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--speed-ramp") == 0 && i + 1 < argc) {
+            tuning.speedRamp = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--spawn-separation") == 0 && i + 1 < argc) {
+            tuning.spawnSeparation = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bins") == 0 && i + 1 < argc) {
+            binCount = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char* format = argv[++i];
+            if (strcmp(format, "csv") != 0 && strcmp(format, "json") != 0) {
+                std::cerr << "Unknown format: " << format << std::endl;
+                return 1;
+            }
+            csv = strcmp(format, "csv") == 0;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outFile = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<GameResult> results(gameCount);
+    const unsigned long long chunkSize = 64;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned poolSize;
+    {
+        WorkPool pool(threads);
+        poolSize = pool.size();
+        for (unsigned long long begin = 0; begin < gameCount; begin += chunkSize) {
+            unsigned long long end = std::min(gameCount, begin + chunkSize);
+            pool.submit([&, begin, end] {
+                GameSim sim;
+                sim.tuning = tuning;
+                simResize(sim, sim.width, sim.height);
+                SimRng botRng;
+                for (unsigned long long g = begin; g < end; g++) {
+                    simReset(sim, seed + g);
+                    rngSeed(botRng, seed + g, 1);
+                    GameResult& r = results[g];
+                    memset(r.laneCollisions, 0, sizeof(r.laneCollisions));
+                    while (!sim.collide && sim.tick < maxGameTicks) {
+                        int dir = botChooseSteer(bot, sim, botRng);
+                        if (dir != 0)
+                            simSteer(sim, dir);
+                        if (simStep(sim) & SIM_EVENT_COLLISION)
+                            r.laneCollisions[sim.lastCollisionLane]++;
+                    }
+                    r.score = sim.score;
+                    r.ticks = sim.tick;
+                }
+            });
+        }
+        pool.wait();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> scores, survival;
+    scores.reserve(gameCount);
+    survival.reserve(gameCount);
+    unsigned long long laneTotals[SIM_NUM_LANES] = {0};
+    unsigned long long totalTicks = 0, cappedGames = 0;
+    for (const GameResult& r : results) {
+        scores.push_back(r.score);
+        survival.push_back(double(r.ticks) / SIM_TICK_RATE);
+        totalTicks += r.ticks;
+        if (r.ticks >= maxGameTicks)
+            cappedGames++;
+        for (int l = 0; l < SIM_NUM_LANES; l++)
+            laneTotals[l] += r.laneCollisions[l];
+    }
+    Distribution scoreDist = summarise(scores, binCount);
+    Distribution survivalDist = summarise(survival, binCount);
+    double gamesPerSec = seconds > 0 ? gameCount / seconds : 0;
+
+    std::ofstream file;
+    if (outFile) {
+        file.open(outFile);
+        if (!file) {
+            std::cerr << "Failed to open output: " << outFile << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = outFile ? file : std::cout;
+    if (csv) {
+        out << "metric,key,value\n";
+        out << "config,policy," << botPolicyName(bot.policy) << "\n";
+        out << "config,reaction_ticks," << bot.reactionTicks << "\n";
+        out << "config,miss_chance," << bot.missChance << "\n";
+        out << "config,games," << gameCount << "\n";
+        out << "config,seed," << seed << "\n";
+        out << "config,speed_ramp," << tuning.speedRamp << "\n";
+        out << "config,spawn_separation," << tuning.spawnSeparation << "\n";
+        out << "config,max_game_ticks," << maxGameTicks << "\n";
+        out << "throughput,threads," << poolSize << "\n";
+        out << "throughput,seconds," << seconds << "\n";
+        out << "throughput,games_per_sec," << gamesPerSec << "\n";
+        out << "throughput,games_per_sec_per_core," << gamesPerSec / poolSize << "\n";
+        out << "throughput,ticks_per_sec," << (seconds > 0 ? totalTicks / seconds : 0) << "\n";
+        out << "games,capped," << cappedGames << "\n";
+        writeDistributionCsv(out, "score", scoreDist);
+        writeDistributionCsv(out, "survival_seconds", survivalDist);
+        for (int l = 0; l < SIM_NUM_LANES; l++)
+            out << "collision_lane," << l << "," << laneTotals[l] << "\n";
+    } else {
+        char line[512];
+        out << "{\n";
+        snprintf(line, sizeof(line),
+                 "  \"config\": {\"policy\": \"%s\", \"reaction_ticks\": %d, \"miss_chance\": %g, \"games\": %llu, \"seed\": %llu, \"speed_ramp\": %g, "
+                 "\"spawn_separation\": %d, \"max_game_ticks\": %u},\n",
+                 botPolicyName(bot.policy), bot.reactionTicks, bot.missChance, gameCount, (unsigned long long)seed, tuning.speedRamp,
+                 tuning.spawnSeparation, maxGameTicks);
+        out << line;
+        snprintf(line, sizeof(line),
+                 "  \"throughput\": {\"threads\": %u, \"seconds\": %.4f, \"games_per_sec\": %.1f, "
+                 "\"games_per_sec_per_core\": %.1f, \"ticks_per_sec\": %.0f},\n",
+                 poolSize, seconds, gamesPerSec, gamesPerSec / poolSize, seconds > 0 ? totalTicks / seconds : 0.0);
+        out << line;
+        out << "  \"capped_games\": " << cappedGames << ",\n";
+        writeDistributionJson(out, "score", scoreDist);
+        writeDistributionJson(out, "survival_seconds", survivalDist);
+        out << "  \"collision_lanes\": [";
+        for (int l = 0; l < SIM_NUM_LANES; l++)
+            out << (l ? ", " : "") << laneTotals[l];
+        out << "]\n}\n";
+    }
+    fprintf(stderr, "%llu games in %.3f s on %u threads: %.0f games/s, %.0f games/s per core\n",
+            gameCount, seconds, poolSize, gamesPerSec, gamesPerSec / poolSize);
+    return 0;
+}
@@ -1,3 +1,6 @@
+// The batch renderer needs the GL 1.5 buffer object entry points, and the
+// glyph atlas the GL 3.0 framebuffer ones.
+#define GL_GLEXT_PROTOTYPES
 #ifdef __APPLE__
 #include <GLUT/glut.h>
 #else
@@ -14,29 +17,114 @@
 #include <vector>
 #include <string>
 #include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <future>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "game_sim.h"
+#include "replay.h"
+#include "frame_profiler.h"
+#include "trace.h"
+#include "render_batch.h"
+#include "glyph_atlas.h"
+#include "render_target.h"
+#include "compositor.h"
+#include "shape_cache.h"
+#include "texture_atlas.h"
+#include "texture_cache.h"
+#include "asset_bundle.h"
+#include "work_pool.h"
+#include "texture_stream.h"
+#include "asset_watch.h"
+#include "audio_output.h"
+#include "engine_sound.h"
+#include "sfx_mixer.h"
 
 // Window dimensions (wider and shorter)
 int winWidth = 700, winHeight = 500;
-const int baseHeight = 500;  // Base height for speed scaling
 
 // Extended game states to include player selection and registration.
 enum GameState { MENU, PLAYER_SELECT, REGISTER, PLAYING, GAME_OVER };
 GameState gameState = MENU;
 
-GLuint carTexture;
-int score = 0;
-bool collide = false;
-int lives = 3;
+// Sprite atlas (see texture_atlas.h). atlasTexture stays 0 until the atlas
+// is resident, or for good if the PNGs are missing; the game draws its
+// flat-colored shapes as placeholders meanwhile. A load fills loadingAtlas,
+// which replaces atlas once its texture is fully uploaded.
+AtlasImage atlas, loadingAtlas;
+GLuint atlasTexture = 0;
+// Sprites stream in behind the menu, which draws none. requestSprites() maps
+// the pre-packed bundle written by asset_pack, or starts decoding the PNGs on
+// a pool; streamSprites() then uploads the atlas a slice per frame.
+enum SpriteLoadState { SPRITES_IDLE, SPRITES_DECODING, SPRITES_UPLOADING, SPRITES_RESIDENT, SPRITES_FAILED };
+SpriteLoadState spriteState = SPRITES_IDLE;
+const size_t SPRITE_UPLOAD_BUDGET = 32 * 1024; // Bytes per frame.
+const char* bundleFile = "assets.bundle";
+bool useBundle = true;
+AssetBundle assetBundle;  // Mapped while its pixels are being uploaded.
+bool parallelDecode = true; // --serial-decode decodes on the GL thread instead.
+// Processed sprites are cached on disk (see texture_cache.h) unless --no-texture-cache.
+const char* textureCacheDir = ".texture_cache";
+bool useTextureCache = true;
+std::atomic<int> spriteCacheHits{0};
+std::unique_ptr<WorkPool> spriteDecodePool;
+RgbaImage decodedSprites[SPRITE_COUNT];
+bool spriteDecoded[SPRITE_COUNT] = {};
+std::atomic<int> spritesPending{0};     // Decode jobs still running.
+std::atomic<bool> spritesPacked{false}; // atlas (or its failure) is ready to upload.
+TextureStream atlasStream;
+
+bool spritesStreaming() {
+    return spriteState == SPRITES_DECODING || spriteState == SPRITES_UPLOADING;
+}
+
+// Hot reload (--hot-reload): the watcher reports changed asset files and
+// applyAssetChanges() reloads them at the top of a frame.
+AssetWatcher assetWatcher;
+bool spriteReloadQueued = false;
+bool spriteReloadFromBundle = false;
+std::future<EngineClip> musicReload; // Background load of sound.mp3, if one is running.
+bool musicReloadQueued = false;
+const int ASSET_WATCH_TIMER_MS = 250; // Menu redraw check for settled changes.
+
+// Startup timing, printed once the first frame is on screen and once the
+// sprites are resident.
+std::chrono::steady_clock::time_point startupBegin;
+double spriteRequestMs = 0;
+bool spriteReload = false; // The load in progress replaces a resident atlas.
+const char* atlasSource = "none";
+bool startupReported = false;
 int highScore = 0; // Global high score variable
 
-// Global pointer for the car engine sound (loaded from "sound.mp3")
-Mix_Music* carEngineMusic = nullptr;
-// New globals for controlling engine sound
-bool engineSoundPlaying = false;
+// The car engine sound (see engine_sound.h): synthesized to follow the game
+// speed, or with --engine-sample the "sound.mp3" loop. --stream-engine plays
+// that the old way, through Mix_Music.
+EngineSound engineSound;
+bool sampledEngine = false;
+bool streamEngine = false;
+// The audio device: --audio-latency picks the buffer size, --null-audio (or
+// no working sound device) discards the output, --audio-dump copies the final
+// mix to a WAV file (see audio_output.h).
+AudioOutput audio;
+AudioProfile audioProfile = AUDIO_BALANCED;
+bool nullAudio = false;
+const char* audioDumpFile = nullptr;
+bool audioOpen = false; // Until closeAudio().
+// Collision, scoring and game-over effects (see sfx_mixer.h), mixed in as an
+// SDL_mixer post effect; update() posts them and never waits on the device.
+SfxMixer sfx;
+bool sfxEnabled = false;
 unsigned int lastMovementTime = 0;
 const unsigned int ENGINE_SOUND_TIMEOUT = 2000; // Inactivity threshold in milliseconds
+// --engine-latency-test N: start and stop the engine sound N times on its own
+// and exit, so the key-to-audible report can be compared between sources.
+int engineLatencyRuns = 0;
+const unsigned int ENGINE_LATENCY_ON_MS = 500;
+const unsigned int ENGINE_LATENCY_OFF_MS = 500; // Past the fade-out, so every start is timed.
 
 // For player selection.
 std::vector<std::string> players; // list of player names
@@ -46,72 +134,477 @@ const int MAX_PLAYERS = 5;
 // Buffer for new player input (used in REGISTER state).
 std::string newPlayerName = "";
 
-// Game variables; lanes updated in reshape.
-int lanes[3] = {150, 250, 350}; // recalculated in reshape.
-int currentLaneIndex = 1;
-int vehicleX = lanes[currentLaneIndex], vehicleY = 70;
-int ovehicleX[4], ovehicleY[4];
-bool obstaclePassed[4]; // track if obstacle has been passed.
-int movd = 0;
-char buffer[10];
-
-enum ObstacleType { OBSTACLE_CAR, OBSTACLE_BUSH, OBSTACLE_GUTTER, OBSTACLE_ROCK };
-ObstacleType oType[4];
+// Game world (see game_sim.h); lanes updated in reshape.
+GameSim game;
+// Seed for every run when given with --seed, otherwise each run picks a fresh one.
+bool fixedSeed = false;
+uint64_t runSeed = 0;
 
-struct BushBlob {
-    float offsetX[5];
-    float offsetY[5];
-    float radius[5];
-    float green[5];
-};
-BushBlob bushBlobs[4];
+// Every run is recorded and written to replayFile at game over, or when the
+// game exits mid-run. There is one slot: each run overwrites the last, so
+// pass --record FILE to keep one. With --replay the inputs come from a
+// recorded file instead of the keyboard.
+Replay replay;
+const char* replayFile = "last_replay.rpl";
+bool replayPlayback = false;
+bool replayUnsaved = false; // A run is being recorded and not yet written.
+size_t replayNext = 0;
+char buffer[10];
 
-// Fonts used for text.
+// Fonts used for text, all baked into glyphs by init().
 void *font18 = GLUT_BITMAP_HELVETICA_18;
 void *boldFont = GLUT_BITMAP_TIMES_ROMAN_24;
+void *smallFont = GLUT_BITMAP_HELVETICA_10; // Profiler overlay.
+GlyphAtlas glyphs;
+
+// The menu title is cached by the compositor (compositor.h) and shown as one
+// quad. It is only drawn again when the text, color or placement changes,
+// which after the first frame means a reshape().
+CachedLayer titleLayer;
+std::string titleText;
+float titleScale = 0, titleOffsetX = 0, titleOffsetY = 0;
+float titleColor[3] = {};
+
+// The score box and its "SCORE:" label, which only move when the window is
+// resized: cached by the compositor and invalidated by reshape(). The digits
+// are drawn on top each frame.
+CachedLayer scoreBoxLayer;
+
+// The road is one quad textured with a single dash period of asphalt and
+// lane markers, repeating vertically; scrolling it is a texture coordinate
+// offset, whatever the window height or number of lanes.
+const int ROAD_LANE_WIDTH = SIM_ROAD_WIDTH / SIM_NUM_LANES;
+const int DASH_PERIOD = 40, DASH_LENGTH = 20, DASH_WIDTH = 10;
+GLuint roadTexture = 0;
 
 // Global mouse coordinates (for hover effects).
 int mouseX = 0, mouseY = 0;
 
-// Global speed multiplier to adjust game pace.
-float speedMultiplier = 1.0f;
+// Fixed-timestep simulation. The world advances in SIM_DT steps regardless of
+// how often display() is called.
+const int MAX_TICKS_PER_FRAME = 5; // Drop time rather than spiral after a long stall.
+float simAccumulator = 0.0f;
+unsigned int lastFrameTime = 0;
+GameState lastFrameState = MENU; // Time spent on other screens is not simulated.
+
+// Frame scheduling. Static screens (everything but PLAYING) are redrawn only
+// when input, a hover change or a reshape posts a redisplay; PLAYING frames are
+// paced by a GLUT timer so the main loop sleeps between them.
+int targetFps = 60;
+double nextFrameTime = 0.0; // In GLUT_ELAPSED_TIME milliseconds.
+bool frameTimerPending = false;
+
+// Rectangles of the hoverable buttons drawn in the last frame, and the one under the mouse.
+struct HoverRect { int x, y, w, h; };
+std::vector<HoverRect> hoverRects;
+int hoveredRect = -1;
+
+// Collects the PLAYING screen's geometry into a few draw calls (see render_batch.h).
+RenderBatch batch;
+// Heart and bush meshes, built once (see shape_cache.h).
+ShapeCache shapes;
+
+// Frame-time profiler for PLAYING frames; F3 toggles its overlay.
+FrameProfiler profiler;
+const double PROFILER_WINDOW_SECONDS = 5.0;
+const float phaseColors[PHASE_COUNT][3] = {
+    {0.6f, 0.4f, 1.0f}, {0.2f, 0.9f, 0.9f}, {0.2f, 0.8f, 0.2f}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.3f, 0.3f},
+    {1.0f, 0.8f, 0.2f}, {1.0f, 0.4f, 0.8f}, {0.3f, 0.6f, 1.0f}
+};
+
+// Per-state CPU accounting, printed at exit when started with --cpu-report.
+bool cpuReportEnabled = false;
+const char* stateNames[] = { "MENU", "PLAYER_SELECT", "REGISTER", "PLAYING", "GAME_OVER" };
+double stateCpuSeconds[5] = {0};
+double stateWallSeconds[5] = {0};
+GameState accountedState = MENU;
+std::clock_t lastAccountCpu = 0;
+std::chrono::steady_clock::time_point lastAccountWall;
+
+int findHoveredRect() {
+    for (size_t i = 0; i < hoverRects.size(); i++) {
+        const HoverRect& r = hoverRects[i];
+        if (mouseX >= r.x && mouseX <= r.x + r.w && mouseY >= r.y && mouseY <= r.y + r.h)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
 
 void mousePassiveMotion(int x, int y) {
     mouseX = x;
     mouseY = winHeight - y;
+    int hovered = findHoveredRect();
+    if (hovered != hoveredRect) {
+        hoveredRect = hovered;
+        glutPostRedisplay();
+    }
+}
+
+// Charges the CPU and wall time since the last call to the state that was active
+// over that interval. Called once per frame, so idle time on a static screen is
+// charged when the event that ends it is handled.
+void accountCpuUsage() {
+    std::clock_t cpuNow = std::clock();
+    std::chrono::steady_clock::time_point wallNow = std::chrono::steady_clock::now();
+    stateCpuSeconds[accountedState] += double(cpuNow - lastAccountCpu) / CLOCKS_PER_SEC;
+    stateWallSeconds[accountedState] += std::chrono::duration<double>(wallNow - lastAccountWall).count();
+    lastAccountCpu = cpuNow;
+    lastAccountWall = wallNow;
+    accountedState = gameState;
+}
+
+void printCpuReport() {
+    accountCpuUsage();
+    std::cout << "CPU usage per state:" << std::endl;
+    for (int i = 0; i < 5; i++) {
+        if (stateWallSeconds[i] <= 0)
+            continue;
+        printf("  %-14s %6.1f%% of one core over %.1f s\n", stateNames[i],
+               100.0 * stateCpuSeconds[i] / stateWallSeconds[i], stateWallSeconds[i]);
+    }
+}
+
+void frameTimer(int) {
+    frameTimerPending = false;
+    if (gameState == PLAYING || spritesStreaming())
+        glutPostRedisplay();
+}
+
+// Arms the timer for the next PLAYING frame at a fixed cadence, resynchronising
+// if a frame ran late rather than bursting to catch up. Menus get frames too
+// while sprites are streaming in, so the upload keeps moving.
+void scheduleNextFrame() {
+    if ((gameState != PLAYING && !spritesStreaming()) || frameTimerPending)
+        return;
+    double now = glutGet(GLUT_ELAPSED_TIME);
+    nextFrameTime += 1000.0 / targetFps;
+    if (nextFrameTime < now)
+        nextFrameTime = now;
+    frameTimerPending = true;
+    glutTimerFunc(static_cast<unsigned int>(nextFrameTime - now), frameTimer, 0);
+}
+
+// Key-to-audio latency of the engine sound, printed at exit.
+void printEngineSoundReport() {
+    engineSoundReport(engineSound);
+}
+
+void sfxEffect(int, void* stream, int length, void* data) {
+    SfxMixer& mixer = *static_cast<SfxMixer*>(data);
+    sfxMix(mixer, static_cast<int16_t*>(stream), length / (2 * mixer.channels));
+}
+
+// Stops the audio thread and frees what it plays. Registered with atexit()
+// after every other audio handler, so it runs first: the mixer callbacks use
+// sfx, engineSound and audio, which are destroyed once the handlers finish.
+void closeAudio() {
+    if (!audioOpen)
+        return;
+    audioOpen = false;
+    Mix_CloseAudio();
+    engineClipFree(engineSound.clip);
+    SDL_Quit();
+}
+
+// Completes the audio dump and prints the buffer size and callback timing.
+void printAudioReport() {
+    audioOutputFinishDump(audio);
+    audioOutputReport(audio);
+}
+
+// Stops the engine sound once there has been no movement for ENGINE_SOUND_TIMEOUT.
+void engineSoundTimer(int) {
+    if (!engineSound.playing)
+        return;
+    unsigned int idle = glutGet(GLUT_ELAPSED_TIME) - lastMovementTime;
+    if (idle > ENGINE_SOUND_TIMEOUT) {
+        TRACE_SCOPE("engineSoundStop");
+        engineSoundStop(engineSound);
+    } else {
+        glutTimerFunc(ENGINE_SOUND_TIMEOUT - idle + 1, engineSoundTimer, 0);
+    }
+}
+
+// Drives --engine-latency-test; run counts the starts so far.
+void engineLatencyTimer(int run) {
+    if (engineSound.playing) {
+        engineSoundStop(engineSound);
+        glutTimerFunc(ENGINE_LATENCY_OFF_MS, engineLatencyTimer, run);
+    } else if (run == engineLatencyRuns) {
+        exit(0); // The report is printed from atexit().
+    } else {
+        engineSoundStart(engineSound);
+        glutTimerFunc(ENGINE_LATENCY_ON_MS, engineLatencyTimer, run + 1);
+    }
 }
 
 // Utility: returns the pixel width for a string (using GLUT bitmap fonts).
 int getTextWidth(const char *text, void *font) {
-    int width = 0;
-    for (int i = 0; text[i] != '\0'; i++)
-        width += glutBitmapWidth(font, text[i]);
-    return width;
+    return glyphTextWidth(glyphs, font, text);
+}
+
+// Uploads RGBA mip levels, top row first, as a new linear-filtered texture.
+// Level i is (width >> i) x (height >> i), at least 1x1.
+GLuint uploadTexture(int width, int height, const unsigned char* const* levels, int levelCount = 1) {
+    TextureStream stream;
+    textureStreamBegin(stream, textureAllocate(width, height, levelCount), width, height,
+                       std::vector<const uint8_t*>(levels, levels + levelCount));
+    textureStreamStep(stream, SIZE_MAX);
+    return stream.texture;
+}
+
+// Builds roadTexture: SIM_ROAD_WIDTH x DASH_PERIOD texels, a dash at every
+// lane boundary in the bottom DASH_LENGTH rows.
+void buildRoadTexture() {
+    std::vector<unsigned char> pixels(SIM_ROAD_WIDTH * DASH_PERIOD * 4);
+    for (int y = 0; y < DASH_PERIOD; y++) {
+        for (int x = 0; x < SIM_ROAD_WIDTH; x++) {
+            int fromBoundary = (x + DASH_WIDTH / 2) % ROAD_LANE_WIDTH;
+            bool dash = y < DASH_LENGTH && x >= DASH_WIDTH / 2 && fromBoundary < DASH_WIDTH &&
+                        x < SIM_ROAD_WIDTH - DASH_WIDTH / 2;
+            unsigned char* p = &pixels[(y * SIM_ROAD_WIDTH + x) * 4];
+            p[0] = p[1] = p[2] = dash ? 255 : 26; // 0.1 gray asphalt.
+            p[3] = 255;
+        }
+    }
+    const unsigned char* level = pixels.data();
+    roadTexture = uploadTexture(SIM_ROAD_WIDTH, DASH_PERIOD, &level);
+    glBindTexture(GL_TEXTURE_2D, roadTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Drawn one texel per pixel, so the dashes keep their hard edges.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Decodes sprite i; whichever job finishes last packs loadingAtlas and
+// builds its mips, still off the GL thread.
+void decodeSpriteJob(int i) {
+    TRACE_SCOPE("decodeSprite");
+    if (useTextureCache) {
+        TRACE_SCOPE("loadSpriteCached");
+        bool hit;
+        spriteDecoded[i] = loadSpriteCached(textureCacheDir, spriteFiles[i], spriteCrops[i], spriteFootprints[i],
+                                            decodedSprites[i], &loadingAtlas.sourceWidth[i],
+                                            &loadingAtlas.sourceHeight[i], &hit);
+        if (hit)
+            spriteCacheHits.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        TRACE_SCOPE("loadSprite");
+        spriteDecoded[i] = loadSprite(spriteFiles[i], spriteCrops[i], spriteFootprints[i], decodedSprites[i],
+                                      &loadingAtlas.sourceWidth[i], &loadingAtlas.sourceHeight[i]);
+    }
+    if (spritesPending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+    TRACE_SCOPE("packAtlas");
+    if (std::all_of(spriteDecoded, spriteDecoded + SPRITE_COUNT, [](bool ok) { return ok; })) {
+        packAtlas(decodedSprites, loadingAtlas);
+        buildAtlasMips(loadingAtlas);
+    }
+    for (RgbaImage& sprite : decodedSprites)
+        sprite = RgbaImage();
+    spritesPacked.store(true, std::memory_order_release);
+}
+
+// Starts the atlas upload straight from the mapped bundle. False if it lacks one of the sprites.
+bool streamAtlasFromBundle(const AssetBundle& bundle) {
+    const BundleTexture* tex = bundleTexture(bundle, "atlas");
+    bool complete = tex != nullptr;
+    for (int i = 0; complete && i < SPRITE_COUNT; i++) {
+        const BundleSprite* sprite = bundleSprite(bundle, spriteFiles[i]);
+        complete = sprite && &bundle.textures[sprite->texture] == tex;
+        if (complete)
+            loadingAtlas.regions[i] = atlasRegion(sprite->x, sprite->y, sprite->width, sprite->height,
+                                                  tex->width, tex->height);
+    }
+    if (!complete) {
+        std::cerr << "Asset bundle " << bundleFile << " has no complete sprite atlas, ignoring it." << std::endl;
+        return false;
+    }
+    std::vector<const uint8_t*> levels;
+    for (uint32_t l = 0; l < tex->levels; l++)
+        levels.push_back(bundlePixels(bundle, *tex, l));
+    loadingAtlas.width = tex->width;
+    loadingAtlas.height = tex->height;
+    textureStreamBegin(atlasStream, textureAllocate(tex->width, tex->height, tex->levels),
+                       tex->width, tex->height, levels);
+    return true;
 }
 
-GLuint loadTexture(const char* filename) {
-    int width, height, channels;
-    unsigned char* image = stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
-    if (!image) {
-        std::cerr << "Failed to load image: " << filename << std::endl;
-        exit(1);
+// Starts loading the atlas into loadingAtlas: maps the bundle if allowBundle
+// and it is usable, or starts decoding the PNGs on a pool (inline with
+// --serial-decode).
+void startSpriteLoad(bool allowBundle) {
+    spriteRequestMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+    loadingAtlas = AtlasImage();
+    if (allowBundle && bundleOpen(bundleFile, assetBundle)) {
+        if (streamAtlasFromBundle(assetBundle)) {
+            atlasSource = bundleFile;
+            spriteState = SPRITES_UPLOADING;
+            return;
+        }
+        bundleClose(assetBundle);
+    }
+    atlasSource = parallelDecode ? "PNGs (parallel decode)" : "PNGs (serial decode)";
+    spriteState = SPRITES_DECODING;
+    spritesPacked.store(false);
+    spritesPending.store(SPRITE_COUNT);
+    spriteCacheHits.store(0);
+    if (!parallelDecode) {
+        for (int i = 0; i < SPRITE_COUNT; i++)
+            decodeSpriteJob(i);
+        return;
     }
-    GLuint tex;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
-                 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    stbi_image_free(image);
-    return tex;
+    unsigned threads = std::min<unsigned>(SPRITE_COUNT, std::thread::hardware_concurrency());
+    spriteDecodePool.reset(new WorkPool(threads));
+    for (int i = 0; i < SPRITE_COUNT; i++)
+        spriteDecodePool->submit([i] { decodeSpriteJob(i); });
+}
+
+// Asks for the sprites; called on the way to the screens that draw them, and
+// a no-op after the first call.
+void requestSprites() {
+    if (spriteState != SPRITES_IDLE)
+        return;
+    TRACE_SCOPE("requestSprites");
+    startSpriteLoad(useBundle);
+}
+
+// Moves the sprites along once per frame: starts the upload when decoding is
+// done, then sends up to SPRITE_UPLOAD_BUDGET bytes. The new texture replaces
+// atlasTexture only once every level is in.
+void streamSprites() {
+    if (spriteState == SPRITES_DECODING && spritesPacked.load(std::memory_order_acquire)) {
+        spriteDecodePool.reset();
+        if (loadingAtlas.pixels.empty()) {
+            std::cerr << "Sprites unavailable" << (atlasTexture ? ", keeping the old ones." : ", drawing plain shapes instead.")
+                      << std::endl;
+            spriteState = atlasTexture ? SPRITES_RESIDENT : SPRITES_FAILED;
+            return;
+        }
+        TRACE_SCOPE("textureAllocate");
+        std::vector<const uint8_t*> levels(1, loadingAtlas.pixels.data());
+        for (const RgbaImage& mip : loadingAtlas.mips)
+            levels.push_back(mip.pixels.data());
+        textureStreamBegin(atlasStream, textureAllocate(loadingAtlas.width, loadingAtlas.height, levels.size()),
+                           loadingAtlas.width, loadingAtlas.height, levels);
+        spriteState = SPRITES_UPLOADING;
+    }
+    if (spriteState != SPRITES_UPLOADING)
+        return;
+    TRACE_SCOPE("streamSprites");
+    {
+        TRACE_SCOPE("textureStreamStep");
+        if (!textureStreamStep(atlasStream, SPRITE_UPLOAD_BUDGET))
+            return;
+    }
+    if (atlasTexture)
+        glDeleteTextures(1, &atlasTexture);
+    atlasTexture = atlasStream.texture;
+    atlas = std::move(loadingAtlas);
+    loadingAtlas = AtlasImage();
+    spriteState = SPRITES_RESIDENT;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+    if (spriteReload)
+        printf("Sprites reloaded from %s in %.1f ms\n", atlasSource, ms - spriteRequestMs);
+    else
+        printf("Sprites resident %.1f ms after startup (requested at %.1f ms), from %s\n", ms, spriteRequestMs, atlasSource);
+    if (assetBundle.data) {
+        bundleClose(assetBundle);
+    } else {
+        if (useTextureCache)
+            printf("Texture cache: %d of %d sprites from %s\n", spriteCacheHits.load(), SPRITE_COUNT, textureCacheDir);
+        printf("Sprite memory, decoded PNG vs uploaded:\n");
+        printAtlasMemory(atlas);
+        // Only the regions are needed from here on.
+        atlas.pixels = std::vector<uint8_t>();
+        atlas.mips.clear();
+    }
+}
+
+bool isSpriteFile(const std::string& name) {
+    return std::find(spriteFiles, spriteFiles + SPRITE_COUNT, name) != spriteFiles + SPRITE_COUNT;
+}
+
+// Handles files the watcher saw change. Sprite changes queue a reload that
+// starts once no load is in flight: from the PNGs, since the bundle would be
+// stale, or from the bundle if that is what changed. sound.mp3 is reloaded
+// on a background thread and swapped in here once it is ready, restarting
+// the engine sound if it was playing. Runs at the top of a frame.
+void applyAssetChanges() {
+    if (!assetWatchRunning(assetWatcher))
+        return;
+    for (const std::string& name : assetWatchTake(assetWatcher)) {
+        if (isSpriteFile(name)) {
+            spriteReloadQueued = true;
+            spriteReloadFromBundle = false;
+        } else if (useBundle && name == bundleFile) {
+            spriteReloadQueued = true;
+            spriteReloadFromBundle = true;
+        } else if (name == "sound.mp3" && sampledEngine) {
+            musicReloadQueued = true;
+        } else {
+            continue;
+        }
+        std::cout << "Asset changed: " << name << std::endl;
+    }
+    // Before the first request there is nothing to replace; it will read the new files.
+    if (spriteReloadQueued && (spriteState == SPRITES_RESIDENT || spriteState == SPRITES_FAILED)) {
+        TRACE_SCOPE("reloadSprites");
+        spriteReloadQueued = false;
+        spriteReload = true;
+        startSpriteLoad(spriteReloadFromBundle);
+    }
+    if (musicReloadQueued && !musicReload.valid()) {
+        musicReloadQueued = false;
+        musicReload = std::async(std::launch::async, [] { return engineClipLoad("sound.mp3", streamEngine); });
+    }
+    if (musicReload.valid() && musicReload.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        EngineClip clip = musicReload.get();
+        if (!engineClipValid(clip)) {
+            std::cerr << "Failed to reload sound.mp3, keeping the old one. SDL_mixer Error: " << Mix_GetError() << std::endl;
+        } else {
+            TRACE_SCOPE("swap engine sound");
+            engineSoundReplace(engineSound, clip);
+            std::cout << "Reloaded sound.mp3" << std::endl;
+        }
+    }
+}
+
+// Redraws the menus when a change has settled or a reload is finishing, so
+// edits show up without input; PLAYING frames check on their own.
+void assetWatchTimer(int) {
+    if (gameState != PLAYING && (assetWatchPending(assetWatcher) || musicReload.valid()))
+        glutPostRedisplay();
+    glutTimerFunc(ASSET_WATCH_TIMER_MS, assetWatchTimer, 0);
+}
+
+void stopAssetWatch() {
+    assetWatchStop(assetWatcher);
 }
 
+// Draws a sprite centered on (x, y), as large as fits in maxWidth x maxHeight
+// without distorting it. The current batch color tints it.
+void drawSprite(SpriteId id, float x, float y, float maxWidth, float maxHeight, bool flipped = false) {
+    const AtlasRegion& r = atlas.regions[id];
+    float scale = std::min(maxWidth / r.width, maxHeight / r.height);
+    float halfW = r.width * scale / 2, halfH = r.height * scale / 2;
+    float vBottom = flipped ? r.vTop : r.vBottom, vTop = flipped ? r.vBottom : r.vTop;
+    batchSprite(batch, atlasTexture, x - halfW, y - halfH, x + halfW, y + halfH, r.u0, vBottom, r.u1, vTop);
+}
+
+// Text is queued in the batch, so it lands on top of any immediate-mode
+// drawing later in the frame; display() flushes the batch before the swap.
 void drawText(const char *text, int x, int y, void *font, float r, float g, float b) {
+    batchColor(batch, r, g, b);
+    if (glyphDrawText(batch, glyphs, font, text, x, y))
+        return;
+    // A font missing from the glyph atlas is drawn straight away instead.
+    batchFlush(batch);
     glColor3f(r, g, b);
     glRasterPos2f(x, y);
-    for (int i = 0; i < strlen(text); i++)
-        glutBitmapCharacter(font, text[i]);
+    for (const char* p = text; *p; p++)
+        glutBitmapCharacter(font, *p);
 }
 
 void drawCenteredText(const char *text, int y, void *font, float r, float g, float b) {
@@ -119,31 +612,71 @@ void drawCenteredText(const char *text, int y, void *font, float r, float g, flo
     drawText(text, (winWidth - width) / 2, y, font, r, g, b);
 }
 
-// Draws a scalable, bold title using the stroke font.
-void drawBigCenteredTitle(const char *text, float y, float scale, float r, float g, float b) {
-    void* font = GLUT_STROKE_MONO_ROMAN;
+// Stroke font extent around the baseline, in font units (GLUT's Roman fonts).
+const float STROKE_ASCENT = 119.05f, STROKE_DESCENT = 33.33f;
+// The title is made bold by drawing it on a 5x5 grid of offsets, with 2px
+// lines, so its pixels reach this far past the glyph outlines.
+const int TITLE_BOLD_MARGIN = 3;
+
+float strokeTextWidth(const char *text) {
     float width = 0;
     for (int i = 0; text[i] != '\0'; i++)
-        width += glutStrokeWidth(font, text[i]);
-    float startX = (winWidth - width * scale) / 2.0f;
-    glPushMatrix();
+        width += glutStrokeWidth(GLUT_STROKE_MONO_ROMAN, text[i]);
+    return width;
+}
+
+// The 25 passes of the bold title, with the baseline starting at (x, y) in
+// the current modelview coordinates.
+void drawBoldStrokeText(const char *text, float x, float y, float scale, float r, float g, float b) {
+    glPushAttrib(GL_LINE_BIT);
+    glLineWidth(2);
     for (int dx = -2; dx <= 2; dx++) {
         for (int dy = -2; dy <= 2; dy++) {
-            glLoadIdentity();
-            glTranslatef(startX + dx, y + dy, 0);
+            glPushMatrix();
+            glTranslatef(x + dx, y + dy, 0);
             glScalef(scale, scale, 1);
             glColor3f(r, g, b);
             for (int i = 0; text[i] != '\0'; i++)
-                glutStrokeCharacter(font, text[i]);
+                glutStrokeCharacter(GLUT_STROKE_MONO_ROMAN, text[i]);
+            glPopMatrix();
         }
     }
-    glPopMatrix();
+    glPopAttrib();
+}
+
+// Draws a scalable, bold title using the stroke font, from titleLayer when
+// nothing about it has changed since it was last drawn there.
+void drawBigCenteredTitle(const char *text, float y, float scale, float r, float g, float b) {
+    float startX = (winWidth - strokeTextWidth(text) * scale) / 2.0f;
+    // The quad sits on whole pixels; the fraction left over goes into the texture.
+    float left = std::floor(startX) - TITLE_BOLD_MARGIN;
+    float bottom = std::floor(y - STROKE_DESCENT * scale) - TITLE_BOLD_MARGIN;
+    float offsetX = startX - left, offsetY = y - bottom;
+    int width = static_cast<int>(std::ceil(offsetX + strokeTextWidth(text) * scale)) + TITLE_BOLD_MARGIN;
+    int height = static_cast<int>(std::ceil(offsetY + STROKE_ASCENT * scale)) + TITLE_BOLD_MARGIN;
+    bool changed = titleText != text || titleScale != scale || titleOffsetX != offsetX || titleOffsetY != offsetY ||
+                   titleColor[0] != r || titleColor[1] != g || titleColor[2] != b;
+    if (changed) {
+        layerInvalidate(titleLayer);
+        titleText = text;
+        titleScale = scale;
+        titleOffsetX = offsetX;
+        titleOffsetY = offsetY;
+        titleColor[0] = r;
+        titleColor[1] = g;
+        titleColor[2] = b;
+    }
+    layerDraw(batch, titleLayer, left, bottom, width, height, [&] {
+        TRACE_SCOPE("renderTitle");
+        drawBoldStrokeText(text, startX, y, scale, r, g, b);
+    });
 }
 
 // Fancy button drawing function.
 void drawFancyButtonCentered(int y, int w, int h, const char* label) {
     int x = (winWidth - w) / 2;
     bool hovered = (mouseX >= x && mouseX <= x + w && mouseY >= y && mouseY <= y + h);
+    hoverRects.push_back({x, y, w, h});
     // Draw shadow.
     glColor3f(0, 0, 0);
     glBegin(GL_QUADS);
@@ -222,222 +755,237 @@ void drawDustbin(int bx, int by, int bw, int bh) {
     glEnd();
 }
 
-void resetBushBlob(int i) {
-    for (int b = 0; b < 5; b++) {
-        bushBlobs[i].offsetX[b] = (rand() % 15) - 7;
-        bushBlobs[i].offsetY[b] = (rand() % 15) - 7;
-        bushBlobs[i].radius[b] = 10 + rand() % 6;
-        bushBlobs[i].green[b] = 0.6f + 0.15f * (rand() % 4);
-        if (bushBlobs[i].green[b] > 1.0f)
-            bushBlobs[i].green[b] = 1.0f;
-    }
+// Ends the run being recorded at the current tick and writes it out.
+void saveReplay() {
+    if (!replayUnsaved)
+        return;
+    replayUnsaved = false;
+    replayEnd(replay, game);
+    if (!writeReplay(replayFile, replay))
+        std::cerr << "Failed to write replay: " << replayFile << std::endl;
 }
 
 void resetGame() {
-    std::cout << "Resetting game..." << std::endl;
-    score = 0;
-    collide = false;
-    lives = 3;
-    currentLaneIndex = 1;
-    vehicleX = lanes[currentLaneIndex];
-    speedMultiplier = 1.0f;
-    
-    for (int i = 0; i < 4; i++) {
-        ovehicleX[i] = lanes[rand() % 3];
-        ovehicleY[i] = 1000 - i * 250;
-        oType[i] = static_cast<ObstacleType>(rand() % 4);
-        obstaclePassed[i] = false;
-        if (oType[i] == OBSTACLE_BUSH)
-            resetBushBlob(i);
+    requestSprites();
+    if (replayPlayback) {
+        std::cout << "Replaying " << replayFile << " (seed " << replay.seed << ")" << std::endl;
+        replayStart(replay, game);
+        replayNext = 0;
+        return;
     }
-    movd = 0;
+    if (!fixedSeed)
+        runSeed = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::cout << "Resetting game... (seed " << runSeed << ")" << std::endl;
+    simReset(game, runSeed);
+    replayBegin(replay, game);
+    replayUnsaved = true;
 }
 
 void drawHeart(float x, float y, float size, bool filled) {
-    glColor3f(1.0f, 0.0f, 0.0f);
+    if (atlasTexture) {
+        // A lost life is the same sprite, faded.
+        batchColor(batch, 1, 1, 1, filled ? 1.0f : 0.3f);
+        drawSprite(SPRITE_HEART, x, y, 24 * size, 24 * size);
+        return;
+    }
+    batchColor(batch, 1.0f, 0.0f, 0.0f);
     if (!filled) {
-        glLineWidth(2);
-        glBegin(GL_LINE_LOOP);
+        batchLineWidth(batch, 2);
+        batchLineLoopAt(batch, shapes.heart.data(), shapeCacheHeartPoints(shapes), x, y, size);
     } else {
-        glBegin(GL_POLYGON);
+        batchPolygonAt(batch, shapes.heart.data(), shapeCacheHeartPoints(shapes), x, y, size);
+    }
+}
+
+// Advances the world by one fixed tick of SIM_DT seconds.
+void update() {
+    if (replayPlayback)
+        replayApply(replay, replayNext, game);
+    int events = simStep(game);
+    if (sfxEnabled) {
+        if (events & SIM_EVENT_COLLISION)
+            sfxPost(sfx, SFX_CRASH);
+        if (events & SIM_EVENT_SCORED)
+            sfxPost(sfx, SFX_PASSED, 0.7f);
+        if (events & SIM_EVENT_GAME_OVER)
+            sfxPost(sfx, SFX_GAME_OVER);
     }
-    for (float angle = 0; angle <= 2 * 3.14159f; angle += 0.01f) {
-        float px = size * 16 * pow(sin(angle), 3);
-        float py = size * (13 * cos(angle) - 5 * cos(2 * angle) - 2 * cos(3 * angle) - cos(4 * angle));
-        glVertex2f(x + px, y + py);
+    // A recording saved on exit ends before game over; playback stops there.
+    bool replayDone = replayPlayback && game.tick == replay.endTick;
+    if ((events & SIM_EVENT_GAME_OVER) || replayDone) {
+        gameState = GAME_OVER;
+        std::cout << "Game Over. Final Score: " << game.score << std::endl;
+        if (replayPlayback) {
+            bool match = game.tick == replay.endTick && simStateHash(game) == replay.finalHash;
+            std::cout << (match ? "Replay matched the recording." : "Replay DIVERGED from the recording!") << std::endl;
+        } else {
+            saveReplay();
+        }
     }
-    glEnd();
+}
+
+// Ends a drawing phase of drawGame(). Drawing only queues into the batch, so
+// while the profiler overlay is up the batch is flushed here and each phase
+// includes its own GL submission; otherwise the frame keeps to one flush, at
+// the end.
+void markDrawPhase(ProfilePhase phase) {
+    if (profiler.visible)
+        batchFlush(batch);
+    profilerMark(profiler, phase);
 }
 
 void drawGame() {
-    float speedFactor = winHeight / static_cast<float>(baseHeight);
-    const int roadWidth = 300;
-    int roadLeft = (winWidth - roadWidth) / 2;
-    int roadRight = roadLeft + roadWidth;
+    TRACE_SCOPE("drawGame");
+    float speedFactor = winHeight / static_cast<float>(SIM_BASE_HEIGHT);
+    int roadLeft = (winWidth - SIM_ROAD_WIDTH) / 2;
+    int roadRight = roadLeft + SIM_ROAD_WIDTH;
     
     // Draw background.
-    glColor3f(0, 1, 0);
-    glBegin(GL_QUADS);
-        glVertex2f(0, 0);
-        glVertex2f(0, winHeight);
-        glVertex2f(winWidth, winHeight);
-        glVertex2f(winWidth, 0);
-    glEnd();
-    // Draw road.
-    glColor3f(0.1, 0.1, 0.1);
-    glBegin(GL_QUADS);
-        glVertex2f(roadLeft, 0);
-        glVertex2f(roadLeft, winHeight);
-        glVertex2f(roadRight, winHeight);
-        glVertex2f(roadRight, 0);
-    glEnd();
-    // Draw lane markers.
-    glColor3f(1, 1, 1);
-    for (int lane = 1; lane < 3; lane++) {
-        int laneX = roadLeft + lane * 100;
-        for (int i = 0; i < 20; i++) {
-            glBegin(GL_QUADS);
-                glVertex2f(laneX - 5, i * 40 + (movd % static_cast<int>(40 * speedFactor * speedMultiplier)));
-                glVertex2f(laneX + 5, i * 40 + (movd % static_cast<int>(40 * speedFactor * speedMultiplier)));
-                glVertex2f(laneX + 5, i * 40 + 20 + (movd % static_cast<int>(40 * speedFactor * speedMultiplier)));
-                glVertex2f(laneX - 5, i * 40 + 20 + (movd % static_cast<int>(40 * speedFactor * speedMultiplier)));
-            glEnd();
-        }
-    }
-    movd -= static_cast<int>(5 * speedFactor * speedMultiplier);
-    if (movd < -static_cast<int>(40 * speedFactor * speedMultiplier))
-        movd = 0;
+    batchColor(batch, 0, 1, 0);
+    batchRect(batch, 0, 0, winWidth, winHeight);
+    markDrawPhase(PHASE_BACKGROUND);
+    // Draw road and lane markers, with a dash starting markerOffset pixels up.
+    int markerPeriod = std::max(1, static_cast<int>(DASH_PERIOD * speedFactor * game.speedMultiplier));
+    float markerOffset = game.movd % markerPeriod;
+    batchColor(batch, 1, 1, 1);
+    batchSprite(batch, roadTexture, roadLeft, 0, roadRight, winHeight, 0, -markerOffset / DASH_PERIOD,
+                1, (winHeight - markerOffset) / DASH_PERIOD);
+    markDrawPhase(PHASE_ROAD);
     
     // Draw player's vehicle.
-    glColor3f(0, 0, 1);
-    glBegin(GL_QUADS);
-        glVertex2f(vehicleX - 25, vehicleY - 20);
-        glVertex2f(vehicleX + 25, vehicleY - 20);
-        glVertex2f(vehicleX + 25, vehicleY + 20);
-        glVertex2f(vehicleX - 25, vehicleY + 20);
-    glEnd();
+    if (atlasTexture) {
+        batchColor(batch, 1, 1, 1);
+        drawSprite(SPRITE_CAR, game.vehicleX, game.vehicleY, 50, 60);
+    } else {
+        batchColor(batch, 0, 0, 1);
+        batchRect(batch, game.vehicleX - 25, game.vehicleY - 20, game.vehicleX + 25, game.vehicleY + 20);
+    }
     
-    // Draw obstacles and check collision.
+    // Draw obstacles.
     for (int i = 0; i < 4; i++) {
-        int x = ovehicleX[i];
-        int y = ovehicleY[i];
-        switch (oType[i]) {
+        int x = game.ovehicleX[i];
+        int y = game.ovehicleY[i];
+        if (atlasTexture) {
+            // Oncoming cars face down the road and are tinted apart from the player's.
+            static const SpriteId obstacleSprites[] = { SPRITE_CAR, SPRITE_BUSH, SPRITE_POTHOLE, SPRITE_ROCK };
+            ObstacleType type = game.oType[i];
+            if (type == OBSTACLE_CAR)
+                batchColor(batch, 0.6f, 0.7f, 1.0f);
+            else
+                batchColor(batch, 1, 1, 1);
+            drawSprite(obstacleSprites[type], x, y, 40, 50, type == OBSTACLE_CAR);
+            continue;
+        }
+        switch (game.oType[i]) {
             case OBSTACLE_CAR:
-                glColor3f(1.0, 0.0, 0.0);
-                glBegin(GL_QUADS);
-                    glVertex2f(x - 20, y - 25);
-                    glVertex2f(x + 20, y - 25);
-                    glVertex2f(x + 20, y + 25);
-                    glVertex2f(x - 20, y + 25);
-                glEnd();
-                glColor3f(0.1, 0.1, 0.1);
-                glBegin(GL_QUADS);
-                    glVertex2f(x - 15, y - 10);
-                    glVertex2f(x + 15, y - 10);
-                    glVertex2f(x + 15, y + 10);
-                    glVertex2f(x - 15, y + 10);
-                glEnd();
+                batchColor(batch, 1.0, 0.0, 0.0);
+                batchRect(batch, x - 20, y - 25, x + 20, y + 25);
+                batchColor(batch, 0.1, 0.1, 0.1);
+                batchRect(batch, x - 15, y - 10, x + 15, y + 10);
                 break;
-            case OBSTACLE_BUSH:
+            case OBSTACLE_BUSH: {
+                const BushMesh& bush = shapeCacheBush(shapes, game, i);
                 for (int b = 0; b < 5; b++) {
-                    float ox = bushBlobs[i].offsetX[b];
-                    float oy = bushBlobs[i].offsetY[b];
-                    float r = bushBlobs[i].radius[b];
-                    float g = bushBlobs[i].green[b];
-                    glColor3f(0.0f, g, 0.0f);
-                    glBegin(GL_POLYGON);
-                    for (int j = 0; j < 20; ++j) {
-                        float theta = j * 2.0f * 3.14159f / 20;
-                        float dx = cos(theta) * r;
-                        float dy = sin(theta) * r;
-                        glVertex2f(x + ox + dx, y + oy + dy);
-                    }
-                    glEnd();
+                    batchColor(batch, 0.0f, bush.green[b], 0.0f);
+                    batchPolygonAt(batch, bush.xy[b], BUSH_BLOB_SEGMENTS, x, y);
                 }
                 break;
+            }
             case OBSTACLE_GUTTER:
-                glColor3f(0.4f, 0.4f, 0.4f);
-                glBegin(GL_QUADS);
-                    glVertex2f(x - 20, y - 25);
-                    glVertex2f(x + 20, y - 25);
-                    glVertex2f(x + 20, y + 25);
-                    glVertex2f(x - 20, y + 25);
-                glEnd();
-                glColor3f(1.0f, 1.0f, 0.0f);
-                for (int l = -20; l <= 20; l += 15) {
-                    glBegin(GL_LINES);
-                        glVertex2f(x + l - 10, y - 25);
-                        glVertex2f(x + l + 10, y + 25);
-                    glEnd();
-                }
+                batchColor(batch, 0.4f, 0.4f, 0.4f);
+                batchRect(batch, x - 20, y - 25, x + 20, y + 25);
+                batchColor(batch, 1.0f, 1.0f, 0.0f);
+                batchLineWidth(batch, 2);
+                for (int l = -20; l <= 20; l += 15)
+                    batchLine(batch, x + l - 10, y - 25, x + l + 10, y + 25);
                 break;
-            case OBSTACLE_ROCK:
-                glColor3f(0.2f, 0.2f, 0.2f);
-                glBegin(GL_POLYGON);
-                    glVertex2f(x - 15, y - 10);
-                    glVertex2f(x - 5, y - 20);
-                    glVertex2f(x + 10, y - 10);
-                    glVertex2f(x + 20, y);
-                    glVertex2f(x + 5, y + 15);
-                    glVertex2f(x - 10, y + 10);
-                glEnd();
+            case OBSTACLE_ROCK: {
+                const float rock[12] = {
+                    x - 15.0f, y - 10.0f, x - 5.0f, y - 20.0f, x + 10.0f, y - 10.0f,
+                    x + 20.0f, float(y), x + 5.0f, y + 15.0f, x - 10.0f, y + 10.0f
+                };
+                batchColor(batch, 0.2f, 0.2f, 0.2f);
+                batchPolygon(batch, rock, 6);
                 break;
-        }
-        // Collision detection.
-        if (!collide && ovehicleX[i] == vehicleX &&
-            ovehicleY[i] > vehicleY - 40 && ovehicleY[i] < vehicleY + 40) {
-            lives--;
-            if (lives <= 0) {
-                collide = true;
-                gameState = GAME_OVER;
-                std::cout << "Game Over. Final Score: " << score << std::endl;
-            } else {
-                vehicleX = lanes[currentLaneIndex = 1];
-            }
-        }
-        ovehicleY[i] -= static_cast<int>(3 * speedFactor * speedMultiplier);
-        if (!collide && !obstaclePassed[i] && ovehicleY[i] + 25 < vehicleY - 20) {
-            score++;
-            obstaclePassed[i] = true;
-        }
-        if (ovehicleY[i] < -static_cast<int>(50 * speedFactor)) {
-            int newX = lanes[rand() % 3];
-            int newY = winHeight;
-            bool valid = true;
-            for (int j = 0; j < 4; j++) {
-                if (j != i && ovehicleX[j] != newX && abs(ovehicleY[j] - newY) < 150) {
-                    valid = false;
-                    break;
-                }
-            }
-            if (valid) {
-                ovehicleX[i] = newX;
-                ovehicleY[i] = newY;
-                oType[i] = static_cast<ObstacleType>(rand() % 4);
-                obstaclePassed[i] = false;
-                if (oType[i] == OBSTACLE_BUSH)
-                    resetBushBlob(i);
             }
         }
     }
+    markDrawPhase(PHASE_OBSTACLES);
     
-    sprintf(buffer, "%05d", score);
-    glColor3f(0, 0, 0);
-    glBegin(GL_QUADS);
-        glVertex2f(10, winHeight - 40);
-        glVertex2f(150, winHeight - 40);
-        glVertex2f(150, winHeight - 10);
-        glVertex2f(10, winHeight - 10);
-    glEnd();
-    drawText("SCORE:", 15, winHeight - 30, boldFont, 1, 0, 0);
+    sprintf(buffer, "%05d", game.score);
+    layerDraw(batch, scoreBoxLayer, 10, winHeight - 40, 140, 30, [] {
+        batchColor(batch, 0, 0, 0);
+        batchRect(batch, 10, winHeight - 40, 150, winHeight - 10);
+        drawText("SCORE:", 15, winHeight - 30, boldFont, 1, 0, 0);
+    });
     drawText(buffer, 100, winHeight - 30, boldFont, 1, 0, 0);
+    markDrawPhase(PHASE_HUD_TEXT);
     for (int i = 0; i < 3; i++) {
         float heartX = 30 + i * 50;
         float heartY = winHeight - 80;
-        drawHeart(heartX, heartY, 1.5f, i < lives);
+        drawHeart(heartX, heartY, 1.5f, i < game.lives);
+    }
+    markDrawPhase(PHASE_HEARTS);
+}
+
+// Profiler overlay, drawn to the right of the SCORE box: a stacked per-phase
+// graph of recent frames against the frame budget, then percentiles and
+// per-phase means over the last PROFILER_WINDOW_SECONDS.
+void drawProfilerOverlay() {
+    const int boxLeft = 160, boxWidth = 300, boxHeight = 183;
+    int boxTop = winHeight - 10;
+    glColor3f(0, 0, 0);
+    glBegin(GL_QUADS);
+        glVertex2f(boxLeft, boxTop - boxHeight);
+        glVertex2f(boxLeft + boxWidth, boxTop - boxHeight);
+        glVertex2f(boxLeft + boxWidth, boxTop);
+        glVertex2f(boxLeft, boxTop);
+    glEnd();
+    
+    // Graph: one 2px bar per frame, newest on the right, 50px = 2x the frame budget.
+    const int graphHeight = 50, graphBars = 145;
+    int graphLeft = boxLeft + 5, graphBottom = boxTop - 5 - graphHeight;
+    float budgetMs = 1000.0f / targetFps;
+    float pxPerMs = graphHeight / (2 * budgetMs);
+    glBegin(GL_QUADS);
+    for (int i = 0; i < graphBars && i < profiler.count; i++) {
+        const ProfiledFrame& f = profilerFrame(profiler, i);
+        float x = graphLeft + (graphBars - 1 - i) * 2;
+        float y = graphBottom;
+        for (int p = 0; p < PHASE_COUNT && y < graphBottom + graphHeight; p++) {
+            float top = std::min(y + f.phase[p] * pxPerMs, float(graphBottom + graphHeight));
+            glColor3fv(phaseColors[p]);
+            glVertex2f(x, y); glVertex2f(x + 2, y);
+            glVertex2f(x + 2, top); glVertex2f(x, top);
+            y = top;
+        }
     }
+    glEnd();
+    glColor3f(0.6f, 0.6f, 0.6f);
+    glBegin(GL_LINES);
+        glVertex2f(graphLeft, graphBottom + graphHeight / 2);
+        glVertex2f(graphLeft + graphBars * 2, graphBottom + graphHeight / 2);
+    glEnd();
     
-    speedMultiplier += 0.0005f;
+    FrameStats stats = profilerStats(profiler, PROFILER_WINDOW_SECONDS);
+    char line[96];
+    sprintf(line, "p50 %.2f  p95 %.2f  p99 %.2f  worst %.2f ms", stats.p50, stats.p95, stats.p99, stats.worst);
+    drawText(line, boxLeft + 5, graphBottom - 14, smallFont, 1, 1, 1);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        int x = boxLeft + 5 + (p % 2) * 145;
+        int y = graphBottom - 30 - (p / 2) * 14;
+        sprintf(line, "%s %.3f ms", profilePhaseNames[p], stats.phaseMean[p]);
+        drawText(line, x, y, smallFont, phaseColors[p][0], phaseColors[p][1], phaseColors[p][2]);
+    }
+    sprintf(line, "last %.0f s, %d frames, budget %.1f ms", PROFILER_WINDOW_SECONDS, stats.frames, budgetMs);
+    drawText(line, boxLeft + 5, boxTop - boxHeight + 34, smallFont, 0.6f, 0.6f, 0.6f);
+    sprintf(line, "batch: %d draw calls, %d vertices; bush rebuilds %d", batch.lastDrawCalls,
+            batch.lastVertices, shapes.bushRebuilds);
+    drawText(line, boxLeft + 5, boxTop - boxHeight + 20, smallFont, 0.6f, 0.6f, 0.6f);
+    // Rebuilds should track invalidations (one per resize or title change), not frames.
+    sprintf(line, "layer rebuilds/invalidations: score box %d/%d, title %d/%d", scoreBoxLayer.rebuilds,
+            scoreBoxLayer.invalidations, titleLayer.rebuilds, titleLayer.invalidations);
+    drawText(line, boxLeft + 5, boxTop - boxHeight + 6, smallFont, 0.6f, 0.6f, 0.6f);
 }
 
 bool isInside(int x, int y, int bx, int by, int bw, int bh) {
@@ -445,6 +993,7 @@ bool isInside(int x, int y, int bx, int by, int bw, int bh) {
 }
 
 void drawPlayerSelection() {
+    TRACE_SCOPE("drawPlayerSelection");
     drawCenteredText("SELECT PLAYER", winHeight - 60, boldFont, 1, 1, 1);
     
     int buttonWidth = 200;
@@ -495,30 +1044,47 @@ void drawRegistration() {
 }
 
 void display() {
-    // Check if it's time to stop the engine sound.
+    TRACE_SCOPE("display");
+    if (cpuReportEnabled)
+        accountCpuUsage();
     unsigned int currentTime = glutGet(GLUT_ELAPSED_TIME);
-    if (engineSoundPlaying && (currentTime - lastMovementTime > ENGINE_SOUND_TIMEOUT)) {
-        Mix_HaltMusic();
-        engineSoundPlaying = false;
+    profilerBeginFrame(profiler); // Kept only if the frame ends PLAYING.
+    
+    // Run as many fixed simulation ticks as real time allows, then render.
+    unsigned int frameTime = currentTime - lastFrameTime;
+    lastFrameTime = currentTime;
+    if (gameState == PLAYING && lastFrameState == PLAYING) {
+        simAccumulator += frameTime / 1000.0f;
+        if (simAccumulator > MAX_TICKS_PER_FRAME * SIM_DT)
+            simAccumulator = MAX_TICKS_PER_FRAME * SIM_DT;
+        while (simAccumulator >= SIM_DT && gameState == PLAYING) {
+            TRACE_SCOPE("update");
+            update();
+            simAccumulator -= SIM_DT;
+        }
+    } else {
+        simAccumulator = 0.0f;
     }
+    lastFrameState = gameState;
+    profilerMark(profiler, PHASE_UPDATE);
+    engineSynthSetSpeed(engineSound.synth, game.speedMultiplier);
+    applyAssetChanges();
+    streamSprites();
+    profilerMark(profiler, PHASE_ASSETS);
     
     glClear(GL_COLOR_BUFFER_BIT);
+    hoverRects.clear();
     if (gameState == MENU) {
-        const char* titleText = "CAR ARCADE GAME";
-        void* strokeFont = GLUT_STROKE_MONO_ROMAN;
-        float textWidth = 0;
-        for (int i = 0; titleText[i] != '\0'; i++) {
-            textWidth += glutStrokeWidth(strokeFont, titleText[i]);
-        }
-        float titleScale = (winWidth * 0.9f) / textWidth;
-        if (titleScale > 0.4f)
-            titleScale = 0.4f;
+        const char* title = "CAR ARCADE GAME";
+        float scale = (winWidth * 0.9f) / strokeTextWidth(title);
+        if (scale > 0.4f)
+            scale = 0.4f;
         int titleY = static_cast<int>(winHeight * 0.65);
         int subtitleY = static_cast<int>(winHeight * 0.58);
         int buttonY = static_cast<int>(winHeight * 0.35);
         const int buttonWidth = 150;
         const int buttonHeight = 50;
-        drawBigCenteredTitle(titleText, titleY, titleScale, 1, 0, 0);
+        drawBigCenteredTitle(title, titleY, scale, 1, 0, 0);
         drawCenteredText("BY Kashish & Ananya", subtitleY, font18, 1, 1, 1);
         drawFancyButtonCentered(buttonY, buttonWidth, buttonHeight, "START GAME");
     }
@@ -530,6 +1096,11 @@ void display() {
     }
     else if (gameState == PLAYING) {
         drawGame();
+        if (profiler.visible) {
+            drawProfilerOverlay();
+            batchFlush(batch); // The overlay's text, so that it is not charged to the swap.
+            profilerSkip(profiler);
+        }
     }
     else if (gameState == GAME_OVER) {
         // Draw GAME OVER texts.
@@ -537,24 +1108,41 @@ void display() {
         drawCenteredText("GAME OVER", winHeight / 2 + 81, boldFont, 1, 0, 0);
         drawCenteredText("GAME OVER", winHeight / 2 + 79, boldFont, 1, 0, 0);
         char scoreStr[32];
-        sprintf(scoreStr, "SCORE:  %05d", score);
+        sprintf(scoreStr, "SCORE:  %05d", game.score);
         drawCenteredText(scoreStr, winHeight / 2 + 40, boldFont, 1, 1, 1);
-        if (score >= highScore) {
-            highScore = score;
+        if (game.score >= highScore) {
+            highScore = game.score;
             drawCenteredText("NEW HIGH SCORE!", winHeight / 2 + 10, boldFont, 1, 1, 0);
         }
         drawFancyButtonCentered(winHeight / 2 - 60, 150, 40, "PLAY AGAIN");
         drawFancyButtonCentered(winHeight / 2 - 110, 150, 40, "CHANGE USER");
     }
-    glutSwapBuffers();
+    batchEndFrame(batch);
+    {
+        TRACE_SCOPE("glutSwapBuffers");
+        glutSwapBuffers();
+    }
+    if (gameState == PLAYING) {
+        profilerMark(profiler, PHASE_SWAP);
+        profilerEndFrame(profiler);
+    }
+    if (!startupReported) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+        printf("Startup: first frame after %.1f ms\n", ms);
+        startupReported = true;
+    }
+    hoveredRect = findHoveredRect();
+    scheduleNextFrame();
 }
 
 void mouseClick(int button, int state, int x, int y) {
     int yflip = winHeight - y;
     if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
+        glutPostRedisplay();
         if (gameState == MENU) {
             if (x >= (winWidth - 150) / 2 && x <= (winWidth + 150) / 2 &&
                 yflip >= winHeight / 2 - 60 && yflip <= winHeight / 2 - 20) {
+                requestSprites();
                 gameState = PLAYER_SELECT;
             }
         }
@@ -588,6 +1176,7 @@ void mouseClick(int button, int state, int x, int y) {
                 if (isInside(x, yflip, bx, by, buttonWidth, buttonHeight)) {
                     currentPlayerIndex = i;
                     std::cout << "Selected player: " << players[i] << std::endl;
+                    resetGame();
                     gameState = PLAYING;
                     return;
                 }
@@ -624,6 +1213,7 @@ void mouseClick(int button, int state, int x, int y) {
 
 void keyboard(unsigned char key, int x, int y) {
     if (gameState == REGISTER) {
+        glutPostRedisplay();
         if (key == 13) {
             if (!newPlayerName.empty()) {
                 players.push_back(newPlayerName);
@@ -644,16 +1234,29 @@ void keyboard(unsigned char key, int x, int y) {
 void keyPress(int key, int x, int y) {
     if (gameState != PLAYING)
         return;
+    if (key == GLUT_KEY_F3) {
+        profiler.visible = !profiler.visible;
+        if (profiler.visible)
+            profilerReset(profiler); // Frames from before measured the phases differently.
+        return;
+    }
+    if (replayPlayback)
+        return;
     // Record movement time and play engine sound if not already playing.
     lastMovementTime = glutGet(GLUT_ELAPSED_TIME);
-    if (!engineSoundPlaying && carEngineMusic) {
-        Mix_PlayMusic(carEngineMusic, -1); // Loop indefinitely.
-        engineSoundPlaying = true;
+    if (!engineSound.playing && engineSoundAvailable(engineSound)) {
+        TRACE_SCOPE("engineSoundStart");
+        engineSoundStart(engineSound); // Loops until engineSoundTimer() stops it.
+        glutTimerFunc(ENGINE_SOUND_TIMEOUT + 1, engineSoundTimer, 0);
+    }
+    if (key == GLUT_KEY_LEFT && simSteer(game, -1)) {
+        replayRecordSteer(replay, game, -1);
+        engineSynthLaneChange(engineSound.synth);
+    }
+    if (key == GLUT_KEY_RIGHT && simSteer(game, 1)) {
+        replayRecordSteer(replay, game, 1);
+        engineSynthLaneChange(engineSound.synth);
     }
-    if (key == GLUT_KEY_LEFT && currentLaneIndex > 0)
-        vehicleX = lanes[--currentLaneIndex];
-    if (key == GLUT_KEY_RIGHT && currentLaneIndex < 2)
-        vehicleX = lanes[++currentLaneIndex];
 }
 
 void reshape(int w, int h) {
@@ -665,72 +1268,159 @@ void reshape(int w, int h) {
     gluOrtho2D(0, w, 0, h);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
-    const int roadWidth = 300;
-    int roadLeft = (w - roadWidth) / 2;
-    lanes[0] = roadLeft + 50;
-    lanes[1] = roadLeft + 150;
-    lanes[2] = roadLeft + 250;
-    vehicleX = lanes[currentLaneIndex];
-    for (int i = 0; i < 4; i++) {
-        float diff0 = fabs(ovehicleX[i] - lanes[0]);
-        float diff1 = fabs(ovehicleX[i] - lanes[1]);
-        float diff2 = fabs(ovehicleX[i] - lanes[2]);
-        if(diff1 < diff0 && diff1 < diff2)
-            ovehicleX[i] = lanes[1];
-        else if(diff2 < diff0 && diff2 < diff1)
-            ovehicleX[i] = lanes[2];
-        else
-            ovehicleX[i] = lanes[0];
-    }
+    layerInvalidate(scoreBoxLayer);
+    glutPostRedisplay();
+    // During playback the recorded resize events drive the simulation instead.
+    if (replayPlayback)
+        return;
+    simResize(game, w, h);
+    if (gameState == PLAYING)
+        replayRecordResize(replay, game);
 }
 
 void init() {
     glClearColor(0, 0, 0, 1);
+    shapeCacheInit(shapes);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     gluOrtho2D(0, winWidth, 0, winHeight);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
+    buildRoadTexture();
+    TRACE_SCOPE("glyphAtlasBuild");
+    if (!glyphAtlasBuild(glyphs, {font18, boldFont, smallFont}))
+        std::cerr << "No framebuffer objects; drawing text with glutBitmapCharacter." << std::endl;
 }
 
 int main(int argc, char **argv) {
+    startupBegin = std::chrono::steady_clock::now();
     // Initialize default players.
     players.push_back("kashish");
     players.push_back("Ananya");
     
+    // Game options; anything unrecognised is left for glutInit().
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            targetFps = atoi(argv[++i]);
+            if (targetFps <= 0)
+                targetFps = 60;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            runSeed = strtoull(argv[++i], nullptr, 10);
+            fixedSeed = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+            if (!readReplay(replayFile, replay)) {
+                std::cerr << "Failed to load replay: " << replayFile << std::endl;
+                return 1;
+            }
+            replayPlayback = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            if (!traceStart(argv[++i])) {
+                std::cerr << "Failed to open trace file: " << argv[i] << std::endl;
+                return 1;
+            }
+            atexit(traceStop);
+        } else if (strcmp(argv[i], "--cpu-report") == 0) {
+            cpuReportEnabled = true;
+            lastAccountCpu = std::clock();
+            lastAccountWall = std::chrono::steady_clock::now();
+            atexit(printCpuReport);
+        } else if (strcmp(argv[i], "--bundle") == 0 && i + 1 < argc) {
+            bundleFile = argv[++i];
+        } else if (strcmp(argv[i], "--no-bundle") == 0) {
+            useBundle = false;
+        } else if (strcmp(argv[i], "--texture-cache") == 0 && i + 1 < argc) {
+            textureCacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--no-texture-cache") == 0) {
+            useTextureCache = false;
+        } else if (strcmp(argv[i], "--serial-decode") == 0) {
+            parallelDecode = false;
+        } else if (strcmp(argv[i], "--engine-sample") == 0) {
+            sampledEngine = true;
+        } else if (strcmp(argv[i], "--stream-engine") == 0) {
+            sampledEngine = true;
+            streamEngine = true;
+        } else if (strcmp(argv[i], "--audio-latency") == 0 && i + 1 < argc) {
+            if (!audioProfileFromName(argv[++i], audioProfile)) {
+                std::cerr << "Unknown --audio-latency " << argv[i] << "; expected low-latency, balanced or power-save."
+                          << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--engine-latency-test") == 0 && i + 1 < argc) {
+            engineLatencyRuns = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--null-audio") == 0) {
+            nullAudio = true;
+        } else if (strcmp(argv[i], "--audio-dump") == 0 && i + 1 < argc) {
+            audioDumpFile = argv[++i];
+        } else if (strcmp(argv[i], "--hot-reload") == 0) {
+            if (assetWatchStart(assetWatcher, "."))
+                atexit(stopAssetWatch);
+        }
+    }
+    atexit(saveReplay); // Closing the window exits from inside glutMainLoop().
+    
+    TRACE_SCOPE_NAMED(startupScope, "startup");
+    
     // Initialize SDL audio and SDL_mixer.
-    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+    TRACE_INSTANT("audioOutputOpen");
+    if (!audioOutputOpen(audio, audioProfile, nullAudio))
         return 1;
+    engineSoundInit(engineSound, audio.bufferFrames);
+    atexit(printEngineSoundReport);
+    if (!sampledEngine && !engineSoundUseSynth(engineSound)) {
+        std::cerr << "Engine synth needs 16-bit audio output, playing sound.mp3 instead." << std::endl;
+        sampledEngine = true;
     }
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        std::cerr << "SDL_mixer could not initialize! SDL_mixer Error: " << Mix_GetError() << std::endl;
-        return 1;
+    if (sampledEngine) {
+        TRACE_SCOPE("load sound.mp3");
+        engineSound.clip = engineClipLoad("sound.mp3", streamEngine);
+        if (!engineClipValid(engineSound.clip))
+            std::cerr << "Failed to load car engine sound! SDL_mixer Error: " << Mix_GetError() << std::endl;
     }
-    carEngineMusic = Mix_LoadMUS("sound.mp3");
-    if (!carEngineMusic) {
-        std::cerr << "Failed to load car engine sound! SDL_mixer Error: " << Mix_GetError() << std::endl;
+    if (engineSound.format == AUDIO_S16SYS) {
+        TRACE_SCOPE("sfxInit");
+        sfxInit(sfx, engineSound.frequency, engineSound.channels);
+        sfxEnabled = Mix_RegisterEffect(MIX_CHANNEL_POST, sfxEffect, nullptr, &sfx) != 0;
     }
+    if (!sfxEnabled)
+        std::cerr << "Sound effects need 16-bit audio output; playing without them." << std::endl;
+    audioOutputMonitor(audio, audioDumpFile);
+    atexit(printAudioReport);
+    audioOpen = true;
+    atexit(closeAudio); // Last, so it runs first; see closeAudio().
     
+    TRACE_INSTANT("glutInit");
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE);
     glutInitWindowSize(winWidth, winHeight);
     glutInitWindowPosition(200, 50);
     glutCreateWindow("Car Arcade Game");
     init();
+    
+    if (replayPlayback) {
+        glutReshapeWindow(replay.width, replay.height);
+        resetGame();
+        gameState = PLAYING;
+    }
+    
     glutDisplayFunc(display);
-    glutIdleFunc(display);
     glutReshapeFunc(reshape);
     glutSpecialFunc(keyPress);
     glutMouseFunc(mouseClick);
     glutKeyboardFunc(keyboard);
     glutPassiveMotionFunc(mousePassiveMotion);
+    if (assetWatchRunning(assetWatcher))
+        glutTimerFunc(ASSET_WATCH_TIMER_MS, assetWatchTimer, 0);
+    if (engineLatencyRuns > 0 && engineSoundAvailable(engineSound))
+        glutTimerFunc(1000, engineLatencyTimer, 0); // After startup has settled.
+    TRACE_SCOPE_END(startupScope); // glutMainLoop() never returns.
     glutMainLoop();
     
-    // Cleanup audio resources (this may not be reached due to glutMainLoop).
-    Mix_FreeMusic(carEngineMusic);
-    Mix_CloseAudio();
-    SDL_Quit();
+    // Not normally reached: the game leaves through exit(), and closeAudio()
+    // runs from atexit() instead.
+    closeAudio();
     
     return 0;
 }
@@ -0,0 +1,59 @@
+// Layered compositing for content that rarely changes. A CachedLayer keeps a
+// rectangle of the screen in a render target (render_target.h); layerDraw()
+// puts it on screen as one textured quad in the batch, and only runs the
+// layer's drawing code again after layerInvalidate() or when the rectangle
+// moves or resizes. Everything drawn into the batch after it lands on top,
+// so dynamic content simply follows its layer.
+//
+// Each layer counts its invalidations and rebuilds, so a layer that is being
+// redrawn more often than its content changes shows up.
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "render_batch.h"
+#include "render_target.h"
+
+struct CachedLayer {
+    RenderTarget target;
+    int left = 0, bottom = 0; // Where target goes on screen.
+    bool valid = false;
+    int invalidations = 0;    // layerInvalidate() calls.
+    int rebuilds = 0;         // Times the content was drawn into target.
+};
+
+inline void layerInvalidate(CachedLayer& layer) {
+    layer.valid = false;
+    layer.invalidations++;
+}
+
+// Queues layer at (left, bottom), width x height in screen coordinates,
+// first calling draw() to fill it if it is stale. draw() works in screen
+// coordinates and may use the batch or immediate mode. Without framebuffer
+// objects it is simply called every time, straight to the screen.
+template <typename DrawFn>
+inline void layerDraw(RenderBatch& batch, CachedLayer& layer, int left, int bottom, int width, int height,
+                      DrawFn draw) {
+    bool fresh = layer.valid && layer.left == left && layer.bottom == bottom &&
+                 layer.target.width == width && layer.target.height == height;
+    if (!fresh) {
+        // Whatever is queued belongs on screen, not in the layer.
+        batchFlush(batch);
+        if (!renderTargetResize(layer.target, width, height)) {
+            draw();
+            return;
+        }
+        renderTargetBegin(layer.target);
+        glTranslatef(-left, -bottom, 0);
+        draw();
+        batchFlush(batch);
+        renderTargetEnd();
+        layer.left = left;
+        layer.bottom = bottom;
+        layer.valid = true;
+        layer.rebuilds++;
+    }
+    batchColor(batch, 1, 1, 1);
+    batchSprite(batch, layer.target.texture, left, bottom, left + width, bottom + height, 0, 0, 1, 1);
+}
+
+#endif
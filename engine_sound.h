@@ -0,0 +1,244 @@
+// The engine sound, from one of three sources:
+// - synthesized (engine_synth.h) in SDL_mixer's music hook, following the
+//   game speed, after engineSoundUseSynth();
+// - a loop decoded to PCM once when loaded and kept resident, faded in and
+//   out on a reserved mixer channel, so starting it costs no file access or
+//   decoding;
+// - streamed through Mix_Music, restarted from the top of the file each
+//   time, which is how the game used to play it; keep that for comparing
+//   latency.
+//
+// Each start is timed until it becomes audible: from engineSoundStart() to
+// the first mixed buffer with the engine in it, plus the position in that
+// buffer and one device buffer for the hardware queue. The onset is looked
+// for in the engine's own output, so sound effects playing at the time do
+// not count: after the synth in the music hook, in an effect on
+// ENGINE_CHANNEL for the resident loop, and for Mix_Music (which has no
+// hook of its own) in a post effect registered before any other. It only
+// understands 16-bit output.
+#ifndef ENGINE_SOUND_H
+#define ENGINE_SOUND_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+#include "engine_synth.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const int ENGINE_CHANNEL = 0;        // Reserved; Mix_PlayChannel(-1, ...) never picks it.
+const int ENGINE_FADE_IN_MS = 15;    // Just enough to avoid a click.
+const int ENGINE_FADE_OUT_MS = 300;
+const int ENGINE_SILENCE_LEVEL = 8;  // 16-bit samples this close to zero count as silence.
+
+// A loaded engine loop: decoded PCM, or a Mix_Music decoded as it plays.
+struct EngineClip {
+    Mix_Chunk* chunk = nullptr;
+    Mix_Music* music = nullptr;
+};
+
+struct EngineSound {
+    EngineClip clip;
+    EngineSynth synth;
+    bool synthesized = false;
+    bool playing = false;
+    int64_t stoppedAt = 0; // engineClockUs() of the last stop.
+    int frequency = 0, channels = 0;
+    Uint16 format = 0;
+    int bufferFrames = 0;
+    // Latency measurement, shared with the audio thread.
+    std::atomic<int64_t> startedAt{0}; // Microseconds; 0 when no start is waiting to be heard.
+    std::atomic<bool> measureMusic{false}; // Playing Mix_Music, so look in the post effect.
+    std::atomic<int> measured{0};
+    std::atomic<int64_t> totalUs{0}, worstUs{0};
+};
+
+inline int64_t engineClockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline bool engineClipValid(const EngineClip& clip) {
+    return clip.chunk || clip.music;
+}
+
+inline void engineClipFree(EngineClip& clip) {
+    if (clip.chunk)
+        Mix_FreeChunk(clip.chunk);
+    if (clip.music)
+        Mix_FreeMusic(clip.music);
+    clip = EngineClip();
+}
+
+// Drops near-silent frames from both ends of a 16-bit chunk: encoder delay
+// and padding would otherwise add latency to every start and a gap to
+// every loop.
+inline void engineTrimSilence(Mix_Chunk* chunk, int channels) {
+    const int16_t* samples = reinterpret_cast<const int16_t*>(chunk->abuf);
+    size_t frames = chunk->alen / (2 * channels);
+    auto loud = [&](size_t frame) {
+        for (int c = 0; c < channels; c++) {
+            if (std::abs(samples[frame * channels + c]) > ENGINE_SILENCE_LEVEL)
+                return true;
+        }
+        return false;
+    };
+    size_t first = 0, last = frames;
+    while (first < last && !loud(first))
+        first++;
+    while (last > first && !loud(last - 1))
+        last--;
+    if (first == last)
+        return;
+    memmove(chunk->abuf, chunk->abuf + first * 2 * channels, (last - first) * 2 * channels);
+    chunk->alen = static_cast<Uint32>((last - first) * 2 * channels);
+}
+
+// Loads filename; safe to call off the main thread once audio is open. The
+// clip is empty if loading failed (see Mix_GetError()).
+inline EngineClip engineClipLoad(const char* filename, bool streamed) {
+    EngineClip clip;
+    if (streamed) {
+        clip.music = Mix_LoadMUS(filename);
+        return clip;
+    }
+    clip.chunk = Mix_LoadWAV(filename);
+    int frequency, channels;
+    Uint16 format;
+    if (clip.chunk && Mix_QuerySpec(&frequency, &format, &channels) && format == AUDIO_S16SYS)
+        engineTrimSilence(clip.chunk, channels);
+    return clip;
+}
+
+// Looks for the first audible sample of a pending start in samples, which
+// hold only the engine. Audio thread.
+inline void engineSoundDetectOnset(EngineSound& engine, const Uint8* stream, int length) {
+    int64_t startedAt = engine.startedAt.load(std::memory_order_acquire);
+    if (!startedAt || engine.format != AUDIO_S16SYS)
+        return;
+    const int16_t* samples = reinterpret_cast<const int16_t*>(stream);
+    int count = length / 2;
+    int i = 0;
+    while (i < count && std::abs(samples[i]) <= ENGINE_SILENCE_LEVEL)
+        i++;
+    if (i == count || !engine.startedAt.compare_exchange_strong(startedAt, 0))
+        return;
+    int64_t queuedUs = (engine.bufferFrames + i / engine.channels) * int64_t(1000000) / engine.frequency;
+    int64_t latency = engineClockUs() - startedAt + queuedUs;
+    engine.measured++;
+    engine.totalUs += latency;
+    int64_t worst = engine.worstUs.load();
+    while (latency > worst && !engine.worstUs.compare_exchange_weak(worst, latency)) {
+    }
+}
+
+// Music hook for the synth; the stream starts out silent, so after mixing
+// it holds the synth alone.
+inline void engineSoundSynthHook(void* data, Uint8* stream, int length) {
+    EngineSound& engine = *static_cast<EngineSound*>(data);
+    engineSynthMix(&engine.synth, stream, length);
+    engineSoundDetectOnset(engine, stream, length);
+}
+
+// Effect on ENGINE_CHANNEL, which sees the loop before it is mixed in.
+inline void engineSoundChannelEffect(int, void* stream, int length, void* data) {
+    engineSoundDetectOnset(*static_cast<EngineSound*>(data), static_cast<Uint8*>(stream), length);
+}
+
+// Post effect for Mix_Music. Registered first, it runs before the sound
+// effects are added, and no channel plays while the engine is streamed.
+inline void engineSoundMusicEffect(int, void* stream, int length, void* data) {
+    EngineSound& engine = *static_cast<EngineSound*>(data);
+    if (engine.measureMusic.load(std::memory_order_relaxed))
+        engineSoundDetectOnset(engine, static_cast<Uint8*>(stream), length);
+}
+
+// Call once audio is open, with the buffer size it was opened with, and
+// before any other post effect is registered. engine must outlive the mixer.
+inline void engineSoundInit(EngineSound& engine, int bufferFrames) {
+    Mix_QuerySpec(&engine.frequency, &engine.format, &engine.channels);
+    engine.bufferFrames = bufferFrames;
+    Mix_ReserveChannels(ENGINE_CHANNEL + 1);
+    Mix_RegisterEffect(MIX_CHANNEL_POST, engineSoundMusicEffect, nullptr, &engine);
+}
+
+// Generates the engine sound from now on instead of playing a clip. Needs
+// 16-bit output; false (and no change) otherwise.
+inline bool engineSoundUseSynth(EngineSound& engine) {
+    if (engine.format != AUDIO_S16SYS)
+        return false;
+    engineSynthInit(engine.synth, engine.frequency, engine.channels);
+    Mix_HookMusic(engineSoundSynthHook, &engine);
+    engine.synthesized = true;
+    return true;
+}
+
+inline bool engineSoundAvailable(const EngineSound& engine) {
+    return engine.synthesized || engineClipValid(engine.clip);
+}
+
+inline void engineSoundStart(EngineSound& engine) {
+    if (engine.playing || !engineSoundAvailable(engine))
+        return;
+    // A restart during the fade-out is heard at once and tells nothing.
+    int64_t now = engineClockUs();
+    int64_t fadeUs = int64_t(std::max<float>(ENGINE_FADE_OUT_MS, ENGINE_SYNTH_RELEASE_MS)) * 1000;
+    engine.measureMusic.store(!engine.synthesized && !engine.clip.chunk, std::memory_order_relaxed);
+    if (engine.stoppedAt == 0 || now - engine.stoppedAt > fadeUs)
+        engine.startedAt.store(now, std::memory_order_release);
+    if (engine.synthesized) {
+        engineSynthSetRunning(engine.synth, true);
+    } else if (engine.clip.chunk) {
+        Mix_FadeInChannel(ENGINE_CHANNEL, engine.clip.chunk, -1, ENGINE_FADE_IN_MS);
+        // Starting the channel drops its effects, so this goes on afterwards.
+        Mix_RegisterEffect(ENGINE_CHANNEL, engineSoundChannelEffect, nullptr, &engine);
+    } else {
+        Mix_PlayMusic(engine.clip.music, -1);
+    }
+    engine.playing = true;
+}
+
+inline void engineSoundStop(EngineSound& engine) {
+    if (!engine.playing)
+        return;
+    if (engine.synthesized)
+        engineSynthSetRunning(engine.synth, false);
+    else if (engine.clip.chunk)
+        Mix_FadeOutChannel(ENGINE_CHANNEL, ENGINE_FADE_OUT_MS);
+    else
+        Mix_HaltMusic();
+    engine.startedAt.store(0);
+    engine.stoppedAt = engineClockUs();
+    engine.playing = false;
+}
+
+// Swaps in a newly loaded clip, restarting the loop if it was playing.
+inline void engineSoundReplace(EngineSound& engine, EngineClip clip) {
+    bool playing = engine.playing;
+    if (engine.clip.chunk)
+        Mix_HaltChannel(ENGINE_CHANNEL);
+    else if (engine.clip.music)
+        Mix_HaltMusic();
+    engine.playing = false;
+    engineClipFree(engine.clip);
+    engine.clip = clip;
+    if (playing)
+        engineSoundStart(engine);
+}
+
+inline void engineSoundReport(const EngineSound& engine) {
+    int measured = engine.measured.load();
+    if (measured == 0)
+        return;
+    printf("Engine sound (%s): key to audible %.1f ms mean, %.1f ms worst over %d starts\n",
+           engine.synthesized ? "synthesized" : engine.clip.music ? "streamed Mix_Music" : "resident PCM", engine.totalUs.load() / 1000.0 / measured,
+           engine.worstUs.load() / 1000.0, measured);
+}
+
+#endif
@@ -0,0 +1,127 @@
+// Procedural engine sound, generated in the audio callback instead of played
+// from a file. A firing-rate oscillator (a few harmonics from a wavetable)
+// plus a sub-octave for rumble and noise bursts on each firing, through a
+// low-pass filter. Pitch and brightness follow the game speed, and a lane
+// change gives a short rev blip.
+//
+// The game thread only writes the atomics at the top of EngineSynth; the
+// audio thread owns everything else and never allocates or locks, so
+// engineSynthMix() is safe to run as SDL_mixer's music hook.
+#ifndef ENGINE_SYNTH_H
+#define ENGINE_SYNTH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+const int ENGINE_SYNTH_TABLE_SIZE = 1024;
+const float ENGINE_SYNTH_IDLE_HZ = 32.0f;     // Firing rate at speedMultiplier 1.
+const float ENGINE_SYNTH_MAX_SPEED = 6.0f;    // speedMultiplier beyond this sounds the same.
+const float ENGINE_SYNTH_VOLUME = 0.35f;      // Of full scale.
+const float ENGINE_SYNTH_ATTACK_MS = 15.0f;
+const float ENGINE_SYNTH_RELEASE_MS = 300.0f;
+const float ENGINE_SYNTH_PITCH_MS = 120.0f;   // How quickly the pitch follows the speed.
+const float ENGINE_SYNTH_BLIP_MS = 150.0f;    // Decay of the lane-change rev.
+
+struct EngineSynth {
+    // Written by the game, read by the audio thread.
+    std::atomic<float> speed{1.0f};
+    std::atomic<bool> running{false};
+    std::atomic<uint32_t> laneChanges{0};
+
+    // Audio thread only.
+    int frequency = 44100, channels = 2;
+    float table[ENGINE_SYNTH_TABLE_SIZE];
+    float phase = 0, subPhase = 0;
+    float hz = ENGINE_SYNTH_IDLE_HZ;
+    float gain = 0, blip = 0, filtered = 0;
+    uint32_t seenLaneChanges = 0;
+    uint32_t noise = 0x9e3779b9u;
+};
+
+// Fills the wavetable; call before the hook is installed.
+inline void engineSynthInit(EngineSynth& synth, int frequency, int channels) {
+    synth.frequency = frequency;
+    synth.channels = channels;
+    const float twoPi = 6.28318531f;
+    for (int i = 0; i < ENGINE_SYNTH_TABLE_SIZE; i++) {
+        float t = twoPi * i / ENGINE_SYNTH_TABLE_SIZE;
+        synth.table[i] = 0.6f * std::sin(t) + 0.3f * std::sin(2 * t + 0.3f) + 0.15f * std::sin(3 * t + 0.9f);
+    }
+}
+
+inline void engineSynthSetSpeed(EngineSynth& synth, float speedMultiplier) {
+    synth.speed.store(speedMultiplier, std::memory_order_relaxed);
+}
+
+inline void engineSynthSetRunning(EngineSynth& synth, bool running) {
+    synth.running.store(running, std::memory_order_relaxed);
+}
+
+inline void engineSynthLaneChange(EngineSynth& synth) {
+    synth.laneChanges.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Per-sample coefficient for a one-pole approach to a target in about ms.
+inline float engineSynthSmoothing(float ms, int frequency) {
+    return 1.0f - std::exp(-1000.0f / (ms * frequency));
+}
+
+// Adds length bytes of 16-bit interleaved engine sound to stream, saturating.
+// Matches SDL_mixer's music hook signature; data is the EngineSynth.
+inline void engineSynthMix(void* data, uint8_t* stream, int length) {
+    EngineSynth& synth = *static_cast<EngineSynth*>(data);
+    float speed = std::min(std::max(synth.speed.load(std::memory_order_relaxed), 1.0f), ENGINE_SYNTH_MAX_SPEED);
+    float targetGain = synth.running.load(std::memory_order_relaxed) ? ENGINE_SYNTH_VOLUME : 0.0f;
+    uint32_t laneChanges = synth.laneChanges.load(std::memory_order_relaxed);
+    if (laneChanges != synth.seenLaneChanges) {
+        synth.seenLaneChanges = laneChanges;
+        synth.blip = 1.0f;
+    }
+    int frames = length / (2 * synth.channels);
+    if (targetGain == 0 && synth.gain < 1e-4f) {
+        synth.gain = 0; // Silent; the output is left alone.
+        return;
+    }
+
+    // Everything that only changes per buffer is worked out here.
+    float rate = static_cast<float>(synth.frequency);
+    float gainStep = engineSynthSmoothing(targetGain > synth.gain ? ENGINE_SYNTH_ATTACK_MS : ENGINE_SYNTH_RELEASE_MS,
+                                          synth.frequency);
+    float pitchStep = engineSynthSmoothing(ENGINE_SYNTH_PITCH_MS, synth.frequency);
+    float blipDecay = 1.0f - engineSynthSmoothing(ENGINE_SYNTH_BLIP_MS, synth.frequency);
+    float targetHz = ENGINE_SYNTH_IDLE_HZ * (0.6f + 0.4f * speed);
+    float cutoff = 300.0f + 250.0f * speed; // Brighter as it speeds up.
+    float filterStep = 1.0f - std::exp(-6.28318531f * cutoff / rate);
+    float noiseLevel = 0.15f + 0.05f * speed;
+
+    int16_t* out = reinterpret_cast<int16_t*>(stream);
+    for (int f = 0; f < frames; f++) {
+        synth.gain += (targetGain - synth.gain) * gainStep;
+        synth.hz += (targetHz - synth.hz) * pitchStep;
+        synth.blip *= blipDecay;
+        float hz = synth.hz * (1.0f + 0.25f * synth.blip);
+        synth.phase += hz / rate;
+        synth.phase -= std::floor(synth.phase);
+        synth.subPhase += 0.5f * hz / rate;
+        synth.subPhase -= std::floor(synth.subPhase);
+
+        float tone = synth.table[static_cast<int>(synth.phase * ENGINE_SYNTH_TABLE_SIZE) & (ENGINE_SYNTH_TABLE_SIZE - 1)];
+        float sub = synth.table[static_cast<int>(synth.subPhase * ENGINE_SYNTH_TABLE_SIZE) & (ENGINE_SYNTH_TABLE_SIZE - 1)];
+        // Noise burst at the start of each firing cycle.
+        synth.noise ^= synth.noise << 13;
+        synth.noise ^= synth.noise >> 17;
+        synth.noise ^= synth.noise << 5;
+        float white = static_cast<int32_t>(synth.noise) * (1.0f / 2147483648.0f);
+        float burst = (1.0f - synth.phase) * (1.0f - synth.phase);
+        float raw = tone + 0.5f * sub + white * burst * noiseLevel * (1.0f + synth.blip);
+        synth.filtered += (raw - synth.filtered) * filterStep;
+
+        int sample = static_cast<int>(synth.filtered * synth.gain * 32767.0f);
+        for (int c = 0; c < synth.channels; c++, out++)
+            *out = static_cast<int16_t>(std::min(32767, std::max(-32768, *out + sample)));
+    }
+}
+
+#endif
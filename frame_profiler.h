@@ -0,0 +1,120 @@
+// Per-frame timing for the in-game profiler overlay. A frame is split into
+// phases with lap-style marks: profilerMark(p) charges the time since the
+// previous mark to phase p. Frames are kept in a ring so percentiles can be
+// taken over the last few seconds.
+//
+// Times are CPU wall time around the GL calls, so a phase shows its submission
+// cost; GPU work the driver defers usually surfaces in PHASE_SWAP.
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+enum ProfilePhase {
+    PHASE_UPDATE,       // Simulation ticks.
+    PHASE_ASSETS,       // Hot reload and sprite streaming.
+    PHASE_BACKGROUND,   // The grass.
+    PHASE_ROAD,         // Road and lane markers, one textured quad.
+    PHASE_OBSTACLES,    // Obstacles and the player's car.
+    PHASE_HUD_TEXT,
+    PHASE_HEARTS,
+    PHASE_SWAP,         // glutSwapBuffers().
+    PHASE_COUNT
+};
+
+const char* const profilePhaseNames[PHASE_COUNT] = {
+    "update", "assets", "grass", "road", "obstacles", "hud text", "hearts", "swap"
+};
+
+const int PROFILER_CAPACITY = 2048; // Frames kept; the window is cut short beyond this.
+
+struct ProfiledFrame {
+    double start;               // Seconds since the profiler was created.
+    float total;                // Milliseconds, all phases.
+    float phase[PHASE_COUNT];   // Milliseconds.
+};
+
+struct FrameStats {
+    int frames = 0;
+    float p50 = 0, p95 = 0, p99 = 0, worst = 0;
+    float phaseMean[PHASE_COUNT] = {};
+};
+
+struct FrameProfiler {
+    bool visible = false;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lap;
+    ProfiledFrame current = {};
+    ProfiledFrame frames[PROFILER_CAPACITY];
+    int head = 0;  // Next slot to write.
+    int count = 0;
+};
+
+inline void profilerBeginFrame(FrameProfiler& prof) {
+    prof.lap = std::chrono::steady_clock::now();
+    prof.current = ProfiledFrame();
+    prof.current.start = std::chrono::duration<double>(prof.lap - prof.origin).count();
+}
+
+inline void profilerMark(FrameProfiler& prof, ProfilePhase phase) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    prof.current.phase[phase] += std::chrono::duration<float, std::milli>(now - prof.lap).count();
+    prof.lap = now;
+}
+
+// Restarts the lap without charging anything, e.g. around the overlay itself.
+inline void profilerSkip(FrameProfiler& prof) {
+    prof.lap = std::chrono::steady_clock::now();
+}
+
+// Forgets the recorded frames.
+inline void profilerReset(FrameProfiler& prof) {
+    prof.head = 0;
+    prof.count = 0;
+}
+
+inline void profilerEndFrame(FrameProfiler& prof) {
+    ProfiledFrame& f = prof.current;
+    f.total = 0;
+    for (int p = 0; p < PHASE_COUNT; p++)
+        f.total += f.phase[p];
+    prof.frames[prof.head] = f;
+    prof.head = (prof.head + 1) % PROFILER_CAPACITY;
+    if (prof.count < PROFILER_CAPACITY)
+        prof.count++;
+}
+
+// The i-th most recent frame (0 = newest). i must be below prof.count.
+inline const ProfiledFrame& profilerFrame(const FrameProfiler& prof, int i) {
+    return prof.frames[(prof.head - 1 - i + PROFILER_CAPACITY) % PROFILER_CAPACITY];
+}
+
+inline FrameStats profilerStats(const FrameProfiler& prof, double windowSeconds) {
+    FrameStats stats;
+    if (prof.count == 0)
+        return stats;
+    double newest = profilerFrame(prof, 0).start;
+    std::vector<float> totals;
+    totals.reserve(prof.count);
+    for (int i = 0; i < prof.count; i++) {
+        const ProfiledFrame& f = profilerFrame(prof, i);
+        if (newest - f.start > windowSeconds)
+            break;
+        totals.push_back(f.total);
+        for (int p = 0; p < PHASE_COUNT; p++)
+            stats.phaseMean[p] += f.phase[p];
+    }
+    stats.frames = static_cast<int>(totals.size());
+    for (int p = 0; p < PHASE_COUNT; p++)
+        stats.phaseMean[p] /= stats.frames;
+    std::sort(totals.begin(), totals.end());
+    stats.p50 = totals[totals.size() * 50 / 100];
+    stats.p95 = totals[totals.size() * 95 / 100];
+    stats.p99 = totals[totals.size() * 99 / 100];
+    stats.worst = totals.back();
+    return stats;
+}
+
+#endif
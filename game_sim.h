@@ -0,0 +1,263 @@
+// Pure game simulation: lanes, obstacles, spawning, collision, scoring, lives
+// and the speed ramp. No GL, GLUT or SDL here, so the same rules drive the
+// windowed game and the headless tools.
+#ifndef GAME_SIM_H
+#define GAME_SIM_H
+
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+const int SIM_BASE_HEIGHT = 500; // Base height for speed scaling
+const int SIM_ROAD_WIDTH = 300;
+const int SIM_NUM_LANES = 3;
+const int SIM_NUM_OBSTACLES = 4;
+const int SIM_START_LIVES = 3;
+
+// simStep() advances one fixed tick; its per-tick constants are tuned for 60 Hz.
+const int SIM_TICK_RATE = 60;
+const float SIM_DT = 1.0f / SIM_TICK_RATE;
+
+enum ObstacleType { OBSTACLE_CAR, OBSTACLE_BUSH, OBSTACLE_GUTTER, OBSTACLE_ROCK };
+
+// Bit flags returned by simStep() describing what happened during the tick.
+enum SimEvent {
+    SIM_EVENT_NONE = 0,
+    SIM_EVENT_COLLISION = 1,      // Player hit an obstacle and lost a life.
+    SIM_EVENT_SCORED = 2,         // An obstacle was passed.
+    SIM_EVENT_GAME_OVER = 4,      // The last life was lost.
+};
+
+// PCG32 generator. Each GameSim owns one, so a run is reproducible from its seed
+// and the player's inputs, and several games can share a process.
+struct SimRng {
+    uint64_t state = 0x853c49e6748fea9bULL;
+    uint64_t inc = 0xda3e39cb94b95bdbULL;
+};
+
+inline uint32_t rngNext(SimRng& rng) {
+    uint64_t old = rng.state;
+    rng.state = old * 6364136223846793005ULL + rng.inc;
+    uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+    uint32_t rot = static_cast<uint32_t>(old >> 59u);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+inline void rngSeed(SimRng& rng, uint64_t seed, uint64_t stream = 0) {
+    rng.state = 0;
+    rng.inc = (stream << 1u) | 1u;
+    rngNext(rng);
+    rng.state += seed;
+    rngNext(rng);
+}
+
+// Uniform integer in [0, n) using a multiply-shift instead of a division.
+inline int rngRange(SimRng& rng, int n) {
+    return static_cast<int>((static_cast<uint64_t>(rngNext(rng)) * static_cast<uint32_t>(n)) >> 32);
+}
+
+struct BushBlob {
+    float offsetX[5];
+    float offsetY[5];
+    float radius[5];
+    float green[5];
+};
+
+// Difficulty knobs. The defaults are the shipped game; the batch tools vary them.
+struct SimTuning {
+    float speedRamp = 0.0005f;   // Added to speedMultiplier every tick.
+    int spawnSeparation = 150;   // Min vertical gap to an obstacle in another lane when respawning.
+};
+
+struct GameSim {
+    SimTuning tuning;
+    int width = 700, height = 500; // Playfield size, same as the window.
+    int lanes[SIM_NUM_LANES] = {150, 250, 350};
+    int currentLaneIndex = 1;
+    int vehicleX = 250, vehicleY = 70;
+    int ovehicleX[SIM_NUM_OBSTACLES] = {}, ovehicleY[SIM_NUM_OBSTACLES] = {};
+    bool obstaclePassed[SIM_NUM_OBSTACLES] = {}; // track if obstacle has been passed.
+    ObstacleType oType[SIM_NUM_OBSTACLES] = {};
+    BushBlob bushBlobs[SIM_NUM_OBSTACLES] = {};
+    unsigned int bushVersion[SIM_NUM_OBSTACLES] = {}; // Bumped whenever a bush's blobs change.
+    int movd = 0;
+    int score = 0;
+    int lives = SIM_START_LIVES;
+    bool collide = false; // Set once the game is over.
+    int lastCollisionLane = -1; // Lane the player was in at the most recent collision.
+    float speedMultiplier = 1.0f;
+    unsigned int tick = 0;
+    uint64_t seed = 0; // Seed passed to the last simReset().
+    SimRng rng;
+};
+
+inline void simResetBushBlob(GameSim& sim, int i) {
+    BushBlob& blob = sim.bushBlobs[i];
+    sim.bushVersion[i]++;
+    for (int b = 0; b < 5; b++) {
+        blob.offsetX[b] = rngRange(sim.rng, 15) - 7;
+        blob.offsetY[b] = rngRange(sim.rng, 15) - 7;
+        blob.radius[b] = 10 + rngRange(sim.rng, 6);
+        blob.green[b] = 0.6f + 0.15f * rngRange(sim.rng, 4);
+        if (blob.green[b] > 1.0f)
+            blob.green[b] = 1.0f;
+    }
+}
+
+// Starts a new game whose obstacle sequence is fully determined by seed.
+inline void simReset(GameSim& sim, uint64_t seed) {
+    sim.seed = seed;
+    rngSeed(sim.rng, seed);
+    sim.score = 0;
+    sim.collide = false;
+    sim.lastCollisionLane = -1;
+    sim.lives = SIM_START_LIVES;
+    sim.currentLaneIndex = 1;
+    sim.vehicleX = sim.lanes[sim.currentLaneIndex];
+    sim.speedMultiplier = 1.0f;
+    sim.tick = 0;
+
+    for (int i = 0; i < SIM_NUM_OBSTACLES; i++) {
+        sim.ovehicleX[i] = sim.lanes[rngRange(sim.rng, SIM_NUM_LANES)];
+        sim.ovehicleY[i] = 1000 - i * 250;
+        sim.oType[i] = static_cast<ObstacleType>(rngRange(sim.rng, 4));
+        sim.obstaclePassed[i] = false;
+        if (sim.oType[i] == OBSTACLE_BUSH)
+            simResetBushBlob(sim, i);
+    }
+    sim.movd = 0;
+}
+
+// Recomputes the lanes for a new playfield size and snaps every car onto them.
+inline void simResize(GameSim& sim, int w, int h) {
+    sim.width = w;
+    sim.height = h;
+    int roadLeft = (w - SIM_ROAD_WIDTH) / 2;
+    sim.lanes[0] = roadLeft + 50;
+    sim.lanes[1] = roadLeft + 150;
+    sim.lanes[2] = roadLeft + 250;
+    sim.vehicleX = sim.lanes[sim.currentLaneIndex];
+    for (int i = 0; i < SIM_NUM_OBSTACLES; i++) {
+        float diff0 = fabs(sim.ovehicleX[i] - sim.lanes[0]);
+        float diff1 = fabs(sim.ovehicleX[i] - sim.lanes[1]);
+        float diff2 = fabs(sim.ovehicleX[i] - sim.lanes[2]);
+        if (diff1 < diff0 && diff1 < diff2)
+            sim.ovehicleX[i] = sim.lanes[1];
+        else if (diff2 < diff0 && diff2 < diff1)
+            sim.ovehicleX[i] = sim.lanes[2];
+        else
+            sim.ovehicleX[i] = sim.lanes[0];
+    }
+}
+
+// Moves the player one lane left (dir < 0) or right (dir > 0).
+// Returns false if already in the outermost lane.
+inline bool simSteer(GameSim& sim, int dir) {
+    if (dir < 0 && sim.currentLaneIndex > 0)
+        sim.vehicleX = sim.lanes[--sim.currentLaneIndex];
+    else if (dir > 0 && sim.currentLaneIndex < SIM_NUM_LANES - 1)
+        sim.vehicleX = sim.lanes[++sim.currentLaneIndex];
+    else
+        return false;
+    return true;
+}
+
+// Pixels an obstacle moves down the screen per tick at the current speed.
+inline int simObstacleStep(const GameSim& sim) {
+    float speedFactor = sim.height / static_cast<float>(SIM_BASE_HEIGHT);
+    return static_cast<int>(3 * speedFactor * sim.speedMultiplier);
+}
+
+// Advances the world by one fixed tick: scrolls the road, moves obstacles,
+// resolves collisions and scoring, and ramps up the speed. Returns SimEvent flags.
+inline int simStep(GameSim& sim) {
+    int events = SIM_EVENT_NONE;
+    float speedFactor = sim.height / static_cast<float>(SIM_BASE_HEIGHT);
+    sim.movd -= static_cast<int>(5 * speedFactor * sim.speedMultiplier);
+    if (sim.movd < -static_cast<int>(40 * speedFactor * sim.speedMultiplier))
+        sim.movd = 0;
+
+    for (int i = 0; i < SIM_NUM_OBSTACLES; i++) {
+        // Collision detection.
+        if (!sim.collide && sim.ovehicleX[i] == sim.vehicleX &&
+            sim.ovehicleY[i] > sim.vehicleY - 40 && sim.ovehicleY[i] < sim.vehicleY + 40) {
+            sim.lives--;
+            sim.lastCollisionLane = sim.currentLaneIndex;
+            events |= SIM_EVENT_COLLISION;
+            if (sim.lives <= 0) {
+                sim.collide = true;
+                events |= SIM_EVENT_GAME_OVER;
+            } else {
+                sim.vehicleX = sim.lanes[sim.currentLaneIndex = 1];
+            }
+        }
+        sim.ovehicleY[i] -= simObstacleStep(sim);
+        if (!sim.collide && !sim.obstaclePassed[i] && sim.ovehicleY[i] + 25 < sim.vehicleY - 20) {
+            sim.score++;
+            sim.obstaclePassed[i] = true;
+            events |= SIM_EVENT_SCORED;
+        }
+        if (sim.ovehicleY[i] < -static_cast<int>(50 * speedFactor)) {
+            int newX = sim.lanes[rngRange(sim.rng, SIM_NUM_LANES)];
+            int newY = sim.height;
+            bool valid = true;
+            for (int j = 0; j < SIM_NUM_OBSTACLES; j++) {
+                if (j != i && sim.ovehicleX[j] != newX && abs(sim.ovehicleY[j] - newY) < sim.tuning.spawnSeparation) {
+                    valid = false;
+                    break;
+                }
+            }
+            if (valid) {
+                sim.ovehicleX[i] = newX;
+                sim.ovehicleY[i] = newY;
+                sim.oType[i] = static_cast<ObstacleType>(rngRange(sim.rng, 4));
+                sim.obstaclePassed[i] = false;
+                if (sim.oType[i] == OBSTACLE_BUSH)
+                    simResetBushBlob(sim, i);
+            }
+        }
+    }
+
+    sim.speedMultiplier += sim.tuning.speedRamp;
+    sim.tick++;
+    return events;
+}
+
+// FNV-1a hash of everything that affects future gameplay. Two runs that agree on
+// this hash at every tick played identically.
+inline uint64_t simStateHash(const GameSim& sim) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h](uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            h ^= (v >> (i * 8)) & 0xff;
+            h *= 0x100000001b3ULL;
+        }
+    };
+    uint32_t speedBits, rampBits;
+    memcpy(&speedBits, &sim.speedMultiplier, sizeof(speedBits));
+    memcpy(&rampBits, &sim.tuning.speedRamp, sizeof(rampBits));
+    mix(rampBits);
+    mix(sim.tuning.spawnSeparation);
+    mix(sim.tick);
+    mix(sim.width);
+    mix(sim.height);
+    mix(sim.currentLaneIndex);
+    mix(sim.vehicleX);
+    mix(sim.vehicleY);
+    for (int i = 0; i < SIM_NUM_OBSTACLES; i++) {
+        mix(sim.ovehicleX[i]);
+        mix(sim.ovehicleY[i]);
+        mix(sim.oType[i]);
+        mix(sim.obstaclePassed[i]);
+    }
+    mix(sim.movd);
+    mix(sim.score);
+    mix(sim.lives);
+    mix(sim.collide);
+    mix(speedBits);
+    mix(sim.rng.state);
+    return h;
+}
+
+#endif
@@ -0,0 +1,205 @@
+// Bitmap text as batched quads. glyphAtlasBuild() draws every printable
+// character of each GLUT bitmap font once, with glutBitmapCharacter, into a
+// render target (render_target.h), then reads it back to find each
+// glyph's lit pixels. Text is then two triangles per character in the
+// RenderBatch (render_batch.h) instead of a glBitmap call each, and string
+// widths come from cached advances, memoized per string.
+//
+// Needs the GL 3.0 framebuffer entry points: define GL_GLEXT_PROTOTYPES
+// before the first GL include, as for render_batch.h.
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+#include "render_batch.h"
+#include "render_target.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const int GLYPH_FIRST = 32, GLYPH_LAST = 126; // Printable ASCII.
+const int GLYPH_COUNT = GLYPH_LAST - GLYPH_FIRST + 1;
+const int GLYPH_ATLAS_WIDTH = 512;
+const size_t GLYPH_WIDTH_CACHE_LIMIT = 256; // Memoized strings per font before starting over.
+
+struct Glyph {
+    int advance;
+    int left, bottom, width, height; // Lit pixels, relative to the pen position.
+    float u0, v0, u1, v1;            // Same rectangle in the atlas.
+};
+
+struct GlyphFont {
+    void* font = nullptr;
+    Glyph glyphs[GLYPH_COUNT];
+    std::unordered_map<std::string, int> widths;
+};
+
+struct GlyphAtlas {
+    GLuint texture = 0;
+    int width = 0, height = 0;
+    std::vector<GlyphFont> fonts;
+};
+
+inline GlyphFont* glyphAtlasFont(GlyphAtlas& atlas, const void* font) {
+    for (GlyphFont& f : atlas.fonts) {
+        if (f.font == font)
+            return &f;
+    }
+    return nullptr;
+}
+
+// Renders fonts into atlas.texture. Needs a current GL context; GL state other
+// than the framebuffer contents is left as it was. False (and an empty atlas)
+// if framebuffer objects are unavailable.
+inline bool glyphAtlasBuild(GlyphAtlas& atlas, const std::vector<void*>& fonts) {
+    // Each glyph gets a cell with room on every side for descenders and
+    // overhang, sized from the font's widest advance (GLUT has no portable
+    // height query); the pen sits pad pixels in from its bottom-left corner.
+    struct Cell { int x, y, width, height, pad; };
+    std::vector<Cell> cells;
+    int x = 0, y = 0, rowHeight = 0;
+    atlas.fonts.assign(fonts.size(), GlyphFont());
+    for (size_t f = 0; f < fonts.size(); f++) {
+        GlyphFont& font = atlas.fonts[f];
+        font.font = fonts[f];
+        int widest = 0;
+        for (int c = GLYPH_FIRST; c <= GLYPH_LAST; c++) {
+            font.glyphs[c - GLYPH_FIRST].advance = glutBitmapWidth(font.font, c);
+            widest = std::max(widest, font.glyphs[c - GLYPH_FIRST].advance);
+        }
+        int pad = widest / 2 + 1;
+        for (int c = GLYPH_FIRST; c <= GLYPH_LAST; c++) {
+            int cellWidth = font.glyphs[c - GLYPH_FIRST].advance + 2 * pad, cellHeight = widest + 2 * pad;
+            if (x + cellWidth > GLYPH_ATLAS_WIDTH) {
+                x = 0;
+                y += rowHeight;
+                rowHeight = 0;
+            }
+            cells.push_back({x, y, cellWidth, cellHeight, pad});
+            x += cellWidth;
+            rowHeight = std::max(rowHeight, cellHeight);
+        }
+    }
+    atlas.width = GLYPH_ATLAS_WIDTH;
+    atlas.height = 1;
+    while (atlas.height < y + rowHeight)
+        atlas.height *= 2;
+
+    // Glyphs are drawn at whole pixels and their native size, which suits
+    // the render target's nearest filtering.
+    RenderTarget target;
+    if (!renderTargetResize(target, atlas.width, atlas.height)) {
+        atlas = GlyphAtlas();
+        return false;
+    }
+    renderTargetBegin(target);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_BLEND);
+    // Opaque white wherever a bitmap bit is set; the batch color tints it.
+    glColor4f(1, 1, 1, 1);
+    size_t cell = 0;
+    for (GlyphFont& font : atlas.fonts) {
+        for (int c = GLYPH_FIRST; c <= GLYPH_LAST; c++, cell++) {
+            glRasterPos2i(cells[cell].x + cells[cell].pad, cells[cell].y + cells[cell].pad);
+            glutBitmapCharacter(font.font, c);
+        }
+    }
+    std::vector<uint8_t> pixels(static_cast<size_t>(atlas.width) * atlas.height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, atlas.width, atlas.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    renderTargetEnd();
+    // Only the texture is needed from here on.
+    atlas.texture = target.texture;
+    glDeleteFramebuffers(1, &target.framebuffer);
+
+    // Shrink each glyph's quad to its lit pixels. Cells do not overlap, so
+    // scanning one cannot pick up a neighbour.
+    cell = 0;
+    for (GlyphFont& font : atlas.fonts) {
+        for (int c = GLYPH_FIRST; c <= GLYPH_LAST; c++, cell++) {
+            const Cell& at = cells[cell];
+            Glyph& g = font.glyphs[c - GLYPH_FIRST];
+            int x1 = at.x + at.width, y1 = at.y + at.height;
+            int minX = x1, minY = y1, maxX = at.x, maxY = at.y;
+            for (int py = at.y; py < y1; py++) {
+                for (int px = at.x; px < x1; px++) {
+                    if (pixels[(static_cast<size_t>(py) * atlas.width + px) * 4 + 3] == 0)
+                        continue;
+                    minX = std::min(minX, px);
+                    maxX = std::max(maxX, px + 1);
+                    minY = std::min(minY, py);
+                    maxY = std::max(maxY, py + 1);
+                }
+            }
+            if (minX >= maxX) {
+                g.left = g.bottom = g.width = g.height = 0; // Blank, like the space.
+                g.u0 = g.v0 = g.u1 = g.v1 = 0;
+                continue;
+            }
+            g.left = minX - at.x - at.pad;
+            g.bottom = minY - at.y - at.pad;
+            g.width = maxX - minX;
+            g.height = maxY - minY;
+            g.u0 = float(minX) / atlas.width;
+            g.v0 = float(minY) / atlas.height;
+            g.u1 = float(maxX) / atlas.width;
+            g.v1 = float(maxY) / atlas.height;
+        }
+    }
+    return true;
+}
+
+// Width of text in pixels, as glutBitmapWidth() would add it up.
+inline int glyphTextWidth(GlyphAtlas& atlas, const void* font, const char* text) {
+    GlyphFont* f = glyphAtlasFont(atlas, font);
+    if (!f) {
+        int width = 0;
+        for (const char* p = text; *p; p++)
+            width += glutBitmapWidth(const_cast<void*>(font), static_cast<unsigned char>(*p));
+        return width;
+    }
+    auto found = f->widths.find(text);
+    if (found != f->widths.end())
+        return found->second;
+    int width = 0;
+    for (const char* p = text; *p; p++) {
+        unsigned char c = *p;
+        if (c >= GLYPH_FIRST && c <= GLYPH_LAST)
+            width += f->glyphs[c - GLYPH_FIRST].advance;
+    }
+    if (f->widths.size() >= GLYPH_WIDTH_CACHE_LIMIT)
+        f->widths.clear();
+    f->widths.emplace(text, width);
+    return width;
+}
+
+// Queues text with its pen starting at (x, y) in the batch's current color.
+// False if font is not in the atlas.
+inline bool glyphDrawText(RenderBatch& batch, GlyphAtlas& atlas, const void* font, const char* text, int x, int y) {
+    GlyphFont* f = glyphAtlasFont(atlas, font);
+    if (!f)
+        return false;
+    for (const char* p = text; *p; p++) {
+        unsigned char c = *p;
+        if (c < GLYPH_FIRST || c > GLYPH_LAST)
+            continue;
+        const Glyph& g = f->glyphs[c - GLYPH_FIRST];
+        if (g.width > 0) {
+            float left = x + g.left, bottom = y + g.bottom;
+            batchSprite(batch, atlas.texture, left, bottom, left + g.width, bottom + g.height,
+                        g.u0, g.v0, g.u1, g.v1);
+        }
+        x += g.advance;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,159 @@
+// Headless driver for the game rules in game_sim.h: no window, no GL and no
+// audio device. Steps games back to back as fast as possible with a bot
+// (see sim_bots.h) or scripted lane changes and prints a summary.
+//
+// Build: g++ -O2 -std=c++17 headless_sim.cpp -o headless_sim
+// Usage: headless_sim [--ticks N] [--games N] [--max-game-ticks N] [--seed N]
+//                     [--policy idle|random|dodge] [--steer-chance P] [--reach PX]
+//                     [--miss-chance P] [--reaction-ticks N]
+//                     [--script FILE] [--record FILE] [--replay FILE]
+//
+// Game k is seeded with seed + k, so the whole run is reproducible.
+// A script file holds one "<tick> <L|R>" lane change per line, with ticks
+// counted from the start of each game.
+//
+// --record FILE saves the first game as a replay (see replay.h); --replay FILE
+// plays a recorded run back and checks that it ends in the recorded state.
+
+#include "game_sim.h"
+#include "replay.h"
+#include "sim_bots.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+struct ScriptedMove {
+    unsigned int tick;
+    int dir;
+};
+
+bool loadScript(const char* filename, std::vector<ScriptedMove>& moves) {
+    std::ifstream in(filename);
+    if (!in)
+        return false;
+    unsigned int tick;
+    char dir;
+    while (in >> tick >> dir)
+        moves.push_back({tick, (dir == 'L' || dir == 'l') ? -1 : 1});
+    std::stable_sort(moves.begin(), moves.end(),
+                     [](const ScriptedMove& a, const ScriptedMove& b) { return a.tick < b.tick; });
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned long long maxTicks = 10000000;
+    unsigned long long maxGames = 0; // 0 = until maxTicks is reached.
+    unsigned int maxGameTicks = 100000;
+    BotConfig bot;
+    bool scripted = false;
+    uint64_t seed = 1;
+    std::vector<ScriptedMove> script;
+    const char* recordFile = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            maxGames = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--max-game-ticks") == 0 && i + 1 < argc) {
+            maxGameTicks = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            if (!botPolicyFromName(argv[++i], bot.policy)) {
+                std::cerr << "Unknown policy: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--steer-chance") == 0 && i + 1 < argc) {
+            bot.steerChance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--reach") == 0 && i + 1 < argc) {
+            bot.reach = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--miss-chance") == 0 && i + 1 < argc) {
+            bot.missChance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--reaction-ticks") == 0 && i + 1 < argc) {
+            bot.reactionTicks = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            if (!loadScript(argv[++i], script)) {
+                std::cerr << "Failed to load script: " << argv[i] << std::endl;
+                return 1;
+            }
+            scripted = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            Replay replay;
+            if (!readReplay(argv[++i], replay)) {
+                std::cerr << "Failed to load replay: " << argv[i] << std::endl;
+                return 1;
+            }
+            GameSim sim;
+            bool match = replayVerify(replay, sim);
+            printf("replay:       %s (seed %llu, %zu events, %u ticks, score %d)\n",
+                   match ? "match" : "DIVERGED", (unsigned long long)replay.seed,
+                   replay.events.size(), replay.endTick, sim.score);
+            return match ? 0 : 2;
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    GameSim sim;
+    simResize(sim, sim.width, sim.height);
+    Replay replay;
+
+    unsigned long long totalTicks = 0, games = 0, totalScore = 0;
+    int bestScore = 0;
+    SimRng inputRng;
+    rngSeed(inputRng, seed, 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (totalTicks < maxTicks && (maxGames == 0 || games < maxGames)) {
+        simReset(sim, seed + games);
+        bool recording = recordFile && games == 0;
+        if (recording)
+            replayBegin(replay, sim);
+        size_t nextMove = 0;
+        while (!sim.collide && sim.tick < maxGameTicks && totalTicks < maxTicks) {
+            int dir = 0;
+            if (!scripted) {
+                dir = botChooseSteer(bot, sim, inputRng);
+            } else {
+                while (nextMove < script.size() && script[nextMove].tick <= sim.tick) {
+                    if (simSteer(sim, script[nextMove].dir) && recording)
+                        replayRecordSteer(replay, sim, script[nextMove].dir);
+                    nextMove++;
+                }
+            }
+            if (dir != 0 && simSteer(sim, dir) && recording)
+                replayRecordSteer(replay, sim, dir);
+            simStep(sim);
+            totalTicks++;
+        }
+        if (recording) {
+            replayEnd(replay, sim);
+            if (!writeReplay(recordFile, replay)) {
+                std::cerr << "Failed to write replay: " << recordFile << std::endl;
+                return 1;
+            }
+        }
+        games++;
+        totalScore += sim.score;
+        bestScore = std::max(bestScore, sim.score);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("games:        %llu\n", games);
+    printf("ticks:        %llu\n", totalTicks);
+    printf("mean score:   %.2f\n", games ? double(totalScore) / games : 0.0);
+    printf("best score:   %d\n", bestScore);
+    printf("mean length:  %.1f s of game time\n", games ? double(totalTicks) / games / SIM_TICK_RATE : 0.0);
+    printf("elapsed:      %.3f s\n", seconds);
+    printf("ticks/sec:    %.0f\n", seconds > 0 ? totalTicks / seconds : 0.0);
+    return 0;
+}
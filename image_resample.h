@@ -0,0 +1,196 @@
+// Image resampling for load-time sprite preparation: a separable Lanczos-3
+// filter for the large downscale from source art to on-screen size, and an
+// alpha-weighted box filter for mip levels. Both average premultiplied color,
+// so the hidden color of transparent pixels does not bleed into edges.
+//
+// The Lanczos passes keep each pixel as one vector of four floats, using SSE
+// when the compiler targets it (always on x86-64) and plain loops otherwise.
+#ifndef IMAGE_RESAMPLE_H
+#define IMAGE_RESAMPLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLE_SSE 1
+#endif
+
+struct RgbaImage {
+    int width = 0, height = 0;
+    std::vector<uint8_t> pixels; // RGBA, top row first.
+};
+
+inline size_t imageBytes(const RgbaImage& image) {
+    return image.pixels.size();
+}
+
+// Box-filters a srcWidth x srcHeight window of src, whose rows are srcStride
+// pixels apart, down to dstWidth x dstHeight.
+inline RgbaImage boxDownscale(const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+                              int dstWidth, int dstHeight) {
+    RgbaImage dst;
+    dst.width = dstWidth;
+    dst.height = dstHeight;
+    dst.pixels.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+    for (int y = 0; y < dstHeight; y++) {
+        int sy0 = y * srcHeight / dstHeight;
+        int sy1 = std::max(sy0 + 1, (y + 1) * srcHeight / dstHeight);
+        for (int x = 0; x < dstWidth; x++) {
+            int sx0 = x * srcWidth / dstWidth;
+            int sx1 = std::max(sx0 + 1, (x + 1) * srcWidth / dstWidth);
+            uint64_t r = 0, g = 0, b = 0, a = 0;
+            for (int sy = sy0; sy < sy1; sy++) {
+                const uint8_t* p = src + (static_cast<size_t>(sy) * srcStride + sx0) * 4;
+                for (int sx = sx0; sx < sx1; sx++, p += 4) {
+                    r += p[0] * p[3];
+                    g += p[1] * p[3];
+                    b += p[2] * p[3];
+                    a += p[3];
+                }
+            }
+            uint8_t* out = &dst.pixels[(static_cast<size_t>(y) * dstWidth + x) * 4];
+            int count = (sy1 - sy0) * (sx1 - sx0);
+            out[0] = a ? static_cast<uint8_t>(r / a) : 0;
+            out[1] = a ? static_cast<uint8_t>(g / a) : 0;
+            out[2] = a ? static_cast<uint8_t>(b / a) : 0;
+            out[3] = static_cast<uint8_t>(a / count);
+        }
+    }
+    return dst;
+}
+
+// Every mip level below a width x height RGBA image, each half the size of
+// the one above, down to 1x1.
+inline std::vector<RgbaImage> buildMipChain(const uint8_t* pixels, int width, int height) {
+    std::vector<RgbaImage> levels;
+    levels.reserve(32);
+    while (width > 1 || height > 1) {
+        int w = std::max(1, width / 2), h = std::max(1, height / 2);
+        levels.push_back(boxDownscale(pixels, width, width, height, w, h));
+        pixels = levels.back().pixels.data();
+        width = w;
+        height = h;
+    }
+    return levels;
+}
+
+// One premultiplied RGBA pixel, as floats in 0..255.
+#ifdef RESAMPLE_SSE
+typedef __m128 Pixel4;
+inline Pixel4 pixelZero() { return _mm_setzero_ps(); }
+inline Pixel4 pixelLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void pixelStore(float* p, Pixel4 v) { _mm_storeu_ps(p, v); }
+inline Pixel4 pixelMulAdd(Pixel4 acc, Pixel4 v, float w) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w))); }
+#else
+struct Pixel4 { float c[4]; };
+inline Pixel4 pixelZero() { return {{0, 0, 0, 0}}; }
+inline Pixel4 pixelLoad(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void pixelStore(float* p, Pixel4 v) { std::copy_n(v.c, 4, p); }
+inline Pixel4 pixelMulAdd(Pixel4 acc, Pixel4 v, float w) {
+    for (int i = 0; i < 4; i++)
+        acc.c[i] += v.c[i] * w;
+    return acc;
+}
+#endif
+
+inline float lanczos3(float x) {
+    if (x == 0)
+        return 1;
+    if (x <= -3 || x >= 3)
+        return 0;
+    float px = 3.14159265f * x;
+    return 3 * std::sin(px) * std::sin(px / 3) / (px * px);
+}
+
+// Filter taps for one axis: output i reads `width` source samples starting
+// at first[i], weighted by weights[i * width ...].
+struct ResampleTaps {
+    int width = 0;
+    std::vector<int> first;
+    std::vector<float> weights;
+};
+
+inline ResampleTaps lanczosTaps(int srcSize, int dstSize) {
+    ResampleTaps taps;
+    float scale = float(srcSize) / dstSize;
+    float stretch = std::max(scale, 1.0f); // Widen the kernel when shrinking.
+    taps.width = std::min(srcSize, 2 * static_cast<int>(std::ceil(3 * stretch)) + 1);
+    taps.first.resize(dstSize);
+    taps.weights.resize(static_cast<size_t>(dstSize) * taps.width);
+    for (int i = 0; i < dstSize; i++) {
+        float center = (i + 0.5f) * scale;
+        int first = static_cast<int>(std::floor(center - taps.width / 2.0f));
+        first = std::max(0, std::min(first, srcSize - taps.width));
+        taps.first[i] = first;
+        float* w = &taps.weights[static_cast<size_t>(i) * taps.width];
+        float sum = 0;
+        for (int k = 0; k < taps.width; k++) {
+            w[k] = lanczos3((first + k + 0.5f - center) / stretch);
+            sum += w[k];
+        }
+        for (int k = 0; k < taps.width; k++)
+            w[k] /= sum;
+    }
+    return taps;
+}
+
+// Lanczos-3 resample of a srcWidth x srcHeight window of src, whose rows are
+// srcStride pixels apart, to dstWidth x dstHeight.
+inline RgbaImage lanczosResample(const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+                                 int dstWidth, int dstHeight) {
+    ResampleTaps xTaps = lanczosTaps(srcWidth, dstWidth);
+    ResampleTaps yTaps = lanczosTaps(srcHeight, dstHeight);
+
+    // Horizontal pass: every source row, premultiplied, to dstWidth float pixels.
+    std::vector<float> row(static_cast<size_t>(srcWidth) * 4);
+    std::vector<float> wide(static_cast<size_t>(srcHeight) * dstWidth * 4);
+    for (int y = 0; y < srcHeight; y++) {
+        const uint8_t* p = src + static_cast<size_t>(y) * srcStride * 4;
+        for (int x = 0; x < srcWidth; x++, p += 4) {
+            float a = p[3] / 255.0f;
+            row[x * 4 + 0] = p[0] * a;
+            row[x * 4 + 1] = p[1] * a;
+            row[x * 4 + 2] = p[2] * a;
+            row[x * 4 + 3] = p[3];
+        }
+        float* out = &wide[static_cast<size_t>(y) * dstWidth * 4];
+        for (int x = 0; x < dstWidth; x++) {
+            const float* in = &row[static_cast<size_t>(xTaps.first[x]) * 4];
+            const float* w = &xTaps.weights[static_cast<size_t>(x) * xTaps.width];
+            Pixel4 acc = pixelZero();
+            for (int k = 0; k < xTaps.width; k++)
+                acc = pixelMulAdd(acc, pixelLoad(in + k * 4), w[k]);
+            pixelStore(out + x * 4, acc);
+        }
+    }
+
+    // Vertical pass, then back to straight alpha. Lanczos overshoots near
+    // hard edges, so everything is clamped.
+    RgbaImage dst;
+    dst.width = dstWidth;
+    dst.height = dstHeight;
+    dst.pixels.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+    for (int y = 0; y < dstHeight; y++) {
+        const float* w = &yTaps.weights[static_cast<size_t>(y) * yTaps.width];
+        const float* in = &wide[static_cast<size_t>(yTaps.first[y]) * dstWidth * 4];
+        uint8_t* out = &dst.pixels[static_cast<size_t>(y) * dstWidth * 4];
+        for (int x = 0; x < dstWidth; x++) {
+            Pixel4 acc = pixelZero();
+            for (int k = 0; k < yTaps.width; k++)
+                acc = pixelMulAdd(acc, pixelLoad(in + (static_cast<size_t>(k) * dstWidth + x) * 4), w[k]);
+            float c[4];
+            pixelStore(c, acc);
+            float a = std::min(255.0f, std::max(0.0f, c[3]));
+            float unpremultiply = a >= 0.5f ? 255.0f / a : 0.0f;
+            for (int i = 0; i < 3; i++)
+                out[x * 4 + i] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, c[i] * unpremultiply)) + 0.5f);
+            out[x * 4 + 3] = static_cast<uint8_t>(a + 0.5f);
+        }
+    }
+    return dst;
+}
+
+#endif
@@ -0,0 +1,205 @@
+// Batched 2D renderer. Triangles, lines and textured sprites are collected with
+// per-vertex color into one array and submitted from a single streaming VBO,
+// one draw call per run of primitives sharing a type and texture, instead of a
+// glBegin/glEnd pair per shape. Sprites are alpha blended and modulated by the
+// current color.
+//
+// Shapes keep their submission order, so anything drawn outside the batch
+// (glBegin shapes, for example) needs a batchFlush() first. Needs the GL 1.5
+// buffer entry points: define GL_GLEXT_PROTOTYPES before the first GL include.
+#ifndef RENDER_BATCH_H
+#define RENDER_BATCH_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct BatchVertex {
+    float x, y;
+    float u, v;
+    uint8_t r, g, b, a;
+};
+
+// A run of vertices drawn with one call.
+struct BatchRange {
+    GLenum mode;        // GL_TRIANGLES or GL_LINES.
+    GLuint texture;     // 0 for flat color.
+    float lineWidth;
+    size_t first, count;
+};
+
+struct RenderBatch {
+    std::vector<BatchVertex> vertices;
+    std::vector<BatchRange> ranges;
+    uint8_t color[4] = {255, 255, 255, 255};
+    float lineWidth = 1.0f;
+    GLuint vbo = 0;
+    size_t vboCapacity = 0; // In vertices.
+    // Counters for the current frame and the last completed one.
+    int frameDrawCalls = 0, frameVertices = 0;
+    int lastDrawCalls = 0, lastVertices = 0;
+};
+
+inline void batchColor(RenderBatch& batch, float r, float g, float b, float a = 1.0f) {
+    batch.color[0] = static_cast<uint8_t>(r * 255 + 0.5f);
+    batch.color[1] = static_cast<uint8_t>(g * 255 + 0.5f);
+    batch.color[2] = static_cast<uint8_t>(b * 255 + 0.5f);
+    batch.color[3] = static_cast<uint8_t>(a * 255 + 0.5f);
+}
+
+inline void batchLineWidth(RenderBatch& batch, float width) {
+    batch.lineWidth = width;
+}
+
+// Makes sure the last range accepts `mode` primitives with `texture`, starting a new one if not.
+inline void batchUseMode(RenderBatch& batch, GLenum mode, GLuint texture = 0) {
+    if (!batch.ranges.empty()) {
+        const BatchRange& last = batch.ranges.back();
+        if (last.mode == mode && last.texture == texture &&
+            (mode != GL_LINES || last.lineWidth == batch.lineWidth))
+            return;
+    }
+    batch.ranges.push_back({mode, texture, batch.lineWidth, batch.vertices.size(), 0});
+}
+
+inline void batchVertex(RenderBatch& batch, float x, float y, float u = 0, float v = 0) {
+    batch.vertices.push_back({x, y, u, v, batch.color[0], batch.color[1], batch.color[2], batch.color[3]});
+    batch.ranges.back().count++;
+}
+
+inline void batchTriangle(RenderBatch& batch, float x0, float y0, float x1, float y1, float x2, float y2) {
+    batchUseMode(batch, GL_TRIANGLES);
+    batchVertex(batch, x0, y0);
+    batchVertex(batch, x1, y1);
+    batchVertex(batch, x2, y2);
+}
+
+// Quad given by its four corners in order (the same order glBegin(GL_QUADS) takes).
+inline void batchQuad(RenderBatch& batch, float x0, float y0, float x1, float y1,
+                      float x2, float y2, float x3, float y3) {
+    batchTriangle(batch, x0, y0, x1, y1, x2, y2);
+    batchTriangle(batch, x0, y0, x2, y2, x3, y3);
+}
+
+inline void batchRect(RenderBatch& batch, float left, float bottom, float right, float top) {
+    batchQuad(batch, left, bottom, right, bottom, right, top, left, top);
+}
+
+// Filled polygon from n interleaved x,y pairs, fanned from the first vertex
+// like GL_POLYGON.
+inline void batchPolygon(RenderBatch& batch, const float* xy, int n) {
+    for (int i = 1; i + 1 < n; i++)
+        batchTriangle(batch, xy[0], xy[1], xy[2 * i], xy[2 * i + 1], xy[2 * i + 2], xy[2 * i + 3]);
+}
+
+// batchPolygon() for a mesh in its own space, scaled by scale and moved to (x, y).
+inline void batchPolygonAt(RenderBatch& batch, const float* xy, int n, float x, float y, float scale = 1.0f) {
+    for (int i = 1; i + 1 < n; i++)
+        batchTriangle(batch, x + xy[0] * scale, y + xy[1] * scale,
+                      x + xy[2 * i] * scale, y + xy[2 * i + 1] * scale,
+                      x + xy[2 * i + 2] * scale, y + xy[2 * i + 3] * scale);
+}
+
+inline void batchLine(RenderBatch& batch, float x0, float y0, float x1, float y1) {
+    batchUseMode(batch, GL_LINES);
+    batchVertex(batch, x0, y0);
+    batchVertex(batch, x1, y1);
+}
+
+// Closed outline from n interleaved x,y pairs, like GL_LINE_LOOP.
+inline void batchLineLoop(RenderBatch& batch, const float* xy, int n) {
+    for (int i = 0; i < n; i++) {
+        int j = (i + 1) % n;
+        batchLine(batch, xy[2 * i], xy[2 * i + 1], xy[2 * j], xy[2 * j + 1]);
+    }
+}
+
+// batchLineLoop() for a mesh in its own space, scaled by scale and moved to (x, y).
+inline void batchLineLoopAt(RenderBatch& batch, const float* xy, int n, float x, float y, float scale = 1.0f) {
+    for (int i = 0; i < n; i++) {
+        int j = (i + 1) % n;
+        batchLine(batch, x + xy[2 * i] * scale, y + xy[2 * i + 1] * scale,
+                  x + xy[2 * j] * scale, y + xy[2 * j + 1] * scale);
+    }
+}
+
+// Textured rectangle; (u0, vBottom) maps to its bottom-left corner and (u1, vTop)
+// to its top-right. Swap vBottom and vTop to flip the image vertically.
+inline void batchSprite(RenderBatch& batch, GLuint texture, float left, float bottom, float right, float top,
+                        float u0, float vBottom, float u1, float vTop) {
+    batchUseMode(batch, GL_TRIANGLES, texture);
+    batchVertex(batch, left, bottom, u0, vBottom);
+    batchVertex(batch, right, bottom, u1, vBottom);
+    batchVertex(batch, right, top, u1, vTop);
+    batchVertex(batch, left, bottom, u0, vBottom);
+    batchVertex(batch, right, top, u1, vTop);
+    batchVertex(batch, left, top, u0, vTop);
+}
+
+// Uploads everything collected so far and draws it.
+inline void batchFlush(RenderBatch& batch) {
+    if (batch.vertices.empty())
+        return;
+    if (!batch.vbo)
+        glGenBuffers(1, &batch.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+    if (batch.vertices.size() > batch.vboCapacity)
+        batch.vboCapacity = batch.vertices.size() * 2;
+    // Respecify (orphan) the storage so the driver need not wait for the previous draw.
+    glBufferData(GL_ARRAY_BUFFER, batch.vboCapacity * sizeof(BatchVertex), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, batch.vertices.size() * sizeof(BatchVertex), batch.vertices.data());
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(BatchVertex), reinterpret_cast<const void*>(offsetof(BatchVertex, x)));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(BatchVertex), reinterpret_cast<const void*>(offsetof(BatchVertex, u)));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(BatchVertex), reinterpret_cast<const void*>(offsetof(BatchVertex, r)));
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLuint bound = 0;
+    for (const BatchRange& range : batch.ranges) {
+        if (range.count == 0)
+            continue;
+        if (range.texture != bound) {
+            if (range.texture) {
+                glEnable(GL_TEXTURE_2D);
+                glBindTexture(GL_TEXTURE_2D, range.texture);
+            } else {
+                glDisable(GL_TEXTURE_2D);
+            }
+            bound = range.texture;
+        }
+        if (range.mode == GL_LINES)
+            glLineWidth(range.lineWidth);
+        glDrawArrays(range.mode, static_cast<GLint>(range.first), static_cast<GLsizei>(range.count));
+        batch.frameDrawCalls++;
+    }
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_BLEND);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    batch.frameVertices += static_cast<int>(batch.vertices.size());
+    batch.vertices.clear();
+    batch.ranges.clear();
+}
+
+// Publishes this frame's counters as lastDrawCalls/lastVertices and resets them.
+inline void batchEndFrame(RenderBatch& batch) {
+    batchFlush(batch);
+    batch.lastDrawCalls = batch.frameDrawCalls;
+    batch.lastVertices = batch.frameVertices;
+    batch.frameDrawCalls = 0;
+    batch.frameVertices = 0;
+}
+
+#endif
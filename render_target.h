@@ -0,0 +1,87 @@
+// Offscreen render targets: a texture with a framebuffer object around it, so
+// something expensive to draw can be drawn into it once and then put on
+// screen as a single textured quad (batchSprite() in render_batch.h).
+//
+// Needs the GL 3.0 framebuffer entry points: define GL_GLEXT_PROTOTYPES
+// before the first GL include, as for render_batch.h.
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+struct RenderTarget {
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    int width = 0, height = 0;
+};
+
+inline void renderTargetDelete(RenderTarget& target) {
+    if (target.framebuffer)
+        glDeleteFramebuffers(1, &target.framebuffer);
+    if (target.texture)
+        glDeleteTextures(1, &target.texture);
+    target = RenderTarget();
+}
+
+// Makes target a width x height RGBA target, reallocating only if the size
+// changed. Its contents are undefined afterwards. False if the framebuffer
+// is unusable, in which case target is left empty.
+inline bool renderTargetResize(RenderTarget& target, int width, int height) {
+    if (target.framebuffer && target.width == width && target.height == height)
+        return true;
+    renderTargetDelete(target);
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    // Drawn back at its own size, pixel for pixel.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        renderTargetDelete(target);
+        return false;
+    }
+    target.width = width;
+    target.height = height;
+    return true;
+}
+
+// Redirects drawing into target, cleared to transparent, with one unit per
+// pixel and the origin at its bottom-left corner. Pair with renderTargetEnd().
+inline void renderTargetBegin(const RenderTarget& target) {
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glPushAttrib(GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_ENABLE_BIT);
+    glViewport(0, 0, target.width, target.height);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, target.width, 0, target.height, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+// Back to the window, with the viewport, matrices, colors and enables as they were.
+inline void renderTargetEnd() {
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+#endif
@@ -0,0 +1,179 @@
+// Input replays for the game simulation. A replay is the run's seed and
+// playfield size, the tick-stamped inputs, and the final state hash; together
+// with game_sim.h that reproduces the run bit for bit.
+//
+// File layout (all integers are unsigned LEB128 varints unless noted):
+//   "CRPL" magic, version, seed, width, height, event count,
+//   events: (tick delta << 2 | kind), plus width and height for REPLAY_RESIZE,
+//   end tick, final state hash (8 bytes, little endian).
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game_sim.h"
+
+#include <cstdio>
+#include <vector>
+
+const unsigned int REPLAY_VERSION = 1;
+
+enum ReplayEventKind { REPLAY_STEER_LEFT, REPLAY_STEER_RIGHT, REPLAY_RESIZE };
+
+struct ReplayEvent {
+    uint32_t tick;  // Applied before simStep() runs this tick.
+    uint8_t kind;
+    int width, height; // REPLAY_RESIZE only.
+};
+
+struct Replay {
+    uint64_t seed = 0;
+    int width = 0, height = 0;
+    std::vector<ReplayEvent> events;
+    uint32_t endTick = 0;
+    uint64_t finalHash = 0;
+};
+
+// Recording. Call replayBegin() right after simReset() and replayEnd() once the run is over.
+inline void replayBegin(Replay& replay, const GameSim& sim) {
+    replay.seed = sim.seed;
+    replay.width = sim.width;
+    replay.height = sim.height;
+    replay.events.clear();
+    replay.endTick = 0;
+    replay.finalHash = 0;
+}
+
+inline void replayRecordSteer(Replay& replay, const GameSim& sim, int dir) {
+    replay.events.push_back({sim.tick, static_cast<uint8_t>(dir < 0 ? REPLAY_STEER_LEFT : REPLAY_STEER_RIGHT), 0, 0});
+}
+
+inline void replayRecordResize(Replay& replay, const GameSim& sim) {
+    replay.events.push_back({sim.tick, REPLAY_RESIZE, sim.width, sim.height});
+}
+
+inline void replayEnd(Replay& replay, const GameSim& sim) {
+    replay.endTick = sim.tick;
+    replay.finalHash = simStateHash(sim);
+}
+
+// Playback. Applies every event due at the current tick, advancing next.
+inline void replayApply(const Replay& replay, size_t& next, GameSim& sim) {
+    while (next < replay.events.size() && replay.events[next].tick <= sim.tick) {
+        const ReplayEvent& e = replay.events[next++];
+        if (e.kind == REPLAY_RESIZE)
+            simResize(sim, e.width, e.height);
+        else
+            simSteer(sim, e.kind == REPLAY_STEER_LEFT ? -1 : 1);
+    }
+}
+
+// Puts sim in the replay's starting state.
+inline void replayStart(const Replay& replay, GameSim& sim) {
+    simResize(sim, replay.width, replay.height);
+    simReset(sim, replay.seed);
+}
+
+// Replays the whole run on sim and reports whether it ends in the recorded state.
+inline bool replayVerify(const Replay& replay, GameSim& sim) {
+    replayStart(replay, sim);
+    size_t next = 0;
+    while (sim.tick < replay.endTick) {
+        replayApply(replay, next, sim);
+        simStep(sim);
+    }
+    return simStateHash(sim) == replay.finalHash;
+}
+
+inline void replayPutVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+inline bool replayGetVarint(const std::vector<uint8_t>& in, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size())
+            return false;
+        uint8_t byte = in[pos++];
+        v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline bool writeReplay(const char* filename, const Replay& replay) {
+    std::vector<uint8_t> out = {'C', 'R', 'P', 'L'};
+    replayPutVarint(out, REPLAY_VERSION);
+    replayPutVarint(out, replay.seed);
+    replayPutVarint(out, replay.width);
+    replayPutVarint(out, replay.height);
+    replayPutVarint(out, replay.events.size());
+    uint32_t lastTick = 0;
+    for (const ReplayEvent& e : replay.events) {
+        replayPutVarint(out, (static_cast<uint64_t>(e.tick - lastTick) << 2) | e.kind);
+        if (e.kind == REPLAY_RESIZE) {
+            replayPutVarint(out, e.width);
+            replayPutVarint(out, e.height);
+        }
+        lastTick = e.tick;
+    }
+    replayPutVarint(out, replay.endTick);
+    for (int i = 0; i < 8; i++)
+        out.push_back(static_cast<uint8_t>(replay.finalHash >> (i * 8)));
+
+    FILE* f = fopen(filename, "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    return fclose(f) == 0 && ok;
+}
+
+inline bool readReplay(const char* filename, Replay& replay) {
+    FILE* f = fopen(filename, "rb");
+    if (!f)
+        return false;
+    std::vector<uint8_t> in;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        in.insert(in.end(), chunk, chunk + n);
+    fclose(f);
+
+    if (in.size() < 4 || memcmp(in.data(), "CRPL", 4) != 0)
+        return false;
+    size_t pos = 4;
+    uint64_t version, seed, width, height, count, endTick;
+    if (!replayGetVarint(in, pos, version) || version != REPLAY_VERSION ||
+        !replayGetVarint(in, pos, seed) || !replayGetVarint(in, pos, width) ||
+        !replayGetVarint(in, pos, height) || !replayGetVarint(in, pos, count))
+        return false;
+    replay.seed = seed;
+    replay.width = static_cast<int>(width);
+    replay.height = static_cast<int>(height);
+    replay.events.clear();
+    uint32_t tick = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t packed, w = 0, h = 0;
+        if (!replayGetVarint(in, pos, packed))
+            return false;
+        tick += static_cast<uint32_t>(packed >> 2);
+        uint8_t kind = packed & 3;
+        if (kind > REPLAY_RESIZE)
+            return false;
+        if (kind == REPLAY_RESIZE && (!replayGetVarint(in, pos, w) || !replayGetVarint(in, pos, h)))
+            return false;
+        replay.events.push_back({tick, kind, static_cast<int>(w), static_cast<int>(h)});
+    }
+    if (!replayGetVarint(in, pos, endTick) || pos + 8 > in.size())
+        return false;
+    replay.endTick = static_cast<uint32_t>(endTick);
+    replay.finalHash = 0;
+    for (int i = 0; i < 8; i++)
+        replay.finalHash |= static_cast<uint64_t>(in[pos++]) << (i * 8);
+    return true;
+}
+
+#endif
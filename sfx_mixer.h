@@ -0,0 +1,214 @@
+// Sound effects. The game thread posts events into a single-producer,
+// single-consumer ring buffer and never waits on the audio device; the
+// audio callback drains it, starts a voice per event from a fixed pool
+// (stealing the one nearest its end when all are busy) and mixes the active
+// voices into the output.
+//
+// The effects are short synthesized clips made once by sfxInit(). After
+// that nothing on the audio path allocates or locks. Mixing uses SSE when
+// the compiler targets it (always on x86-64) and plain loops otherwise.
+#ifndef SFX_MIXER_H
+#define SFX_MIXER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SFX_SSE 1
+#endif
+
+enum SfxId {
+    SFX_CRASH,     // A collision, which costs a life.
+    SFX_PASSED,    // An obstacle was passed.
+    SFX_GAME_OVER, // The last life was lost.
+    SFX_COUNT
+};
+
+const int SFX_QUEUE_SIZE = 64; // Power of two.
+const int SFX_VOICES = 8;
+const int SFX_MIX_FRAMES = 1024; // Mixed per pass; longer callbacks take several.
+
+struct SfxEvent {
+    SfxId id;
+    float gain;
+};
+
+struct SfxVoice {
+    const std::vector<float>* clip = nullptr; // Null when free.
+    size_t position = 0;
+    float gain = 0;
+};
+
+struct SfxMixer {
+    // Ring buffer: the game thread advances head, the audio thread tail.
+    SfxEvent events[SFX_QUEUE_SIZE];
+    alignas(64) std::atomic<uint32_t> head{0};
+    alignas(64) std::atomic<uint32_t> tail{0};
+    std::atomic<int> dropped{0}; // Events lost to a full queue.
+
+    // Audio thread only, once sfxInit() has run.
+    int channels = 2;
+    std::vector<float> clips[SFX_COUNT]; // Mono, at the output rate.
+    SfxVoice voices[SFX_VOICES];
+    int stolen = 0;
+    alignas(16) float mix[SFX_MIX_FRAMES];
+};
+
+// Renders the effect clips at the output rate; call before the mixer is hooked up.
+inline void sfxInit(SfxMixer& sfx, int frequency, int channels) {
+    sfx.channels = channels;
+    const float twoPi = 6.28318531f;
+    float rate = static_cast<float>(frequency);
+    uint32_t noise = 0x2545f491u;
+    auto white = [&noise] {
+        noise ^= noise << 13;
+        noise ^= noise >> 17;
+        noise ^= noise << 5;
+        return static_cast<int32_t>(noise) * (1.0f / 2147483648.0f);
+    };
+
+    // Crash: a falling thump under a burst of filtered noise.
+    std::vector<float>& crash = sfx.clips[SFX_CRASH];
+    crash.resize(static_cast<size_t>(0.45f * rate));
+    float lowpass = 0, phase = 0;
+    for (size_t i = 0; i < crash.size(); i++) {
+        float t = i / rate;
+        lowpass += (white() - lowpass) * 0.25f;
+        phase += (90.0f - 60.0f * t) / rate;
+        crash[i] = (0.8f * lowpass * std::exp(-t * 9) + 0.6f * std::sin(twoPi * phase) * std::exp(-t * 6));
+    }
+
+    // Passed: two quick rising notes.
+    std::vector<float>& passed = sfx.clips[SFX_PASSED];
+    passed.resize(static_cast<size_t>(0.14f * rate));
+    for (size_t i = 0; i < passed.size(); i++) {
+        float t = i / rate;
+        float hz = t < 0.06f ? 880.0f : 1320.0f;
+        float note = t < 0.06f ? t : t - 0.06f;
+        passed[i] = 0.35f * std::sin(twoPi * hz * t) * std::exp(-note * 30);
+    }
+
+    // Game over: a square-ish tone sliding down two octaves.
+    std::vector<float>& over = sfx.clips[SFX_GAME_OVER];
+    over.resize(static_cast<size_t>(0.9f * rate));
+    phase = 0;
+    for (size_t i = 0; i < over.size(); i++) {
+        float t = i / rate;
+        phase += 440.0f * std::pow(0.25f, t / 0.9f) / rate;
+        phase -= std::floor(phase);
+        float square = std::sin(twoPi * phase) + std::sin(3 * twoPi * phase) / 3;
+        over[i] = 0.3f * square * std::min(1.0f, (0.9f - t) * 10);
+    }
+}
+
+// Queues an effect from the game thread. Never blocks; if the audio thread
+// has fallen SFX_QUEUE_SIZE events behind, the event is dropped and counted.
+inline bool sfxPost(SfxMixer& sfx, SfxId id, float gain = 1.0f) {
+    uint32_t head = sfx.head.load(std::memory_order_relaxed);
+    if (head - sfx.tail.load(std::memory_order_acquire) == SFX_QUEUE_SIZE) {
+        sfx.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    sfx.events[head & (SFX_QUEUE_SIZE - 1)] = {id, gain};
+    sfx.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// Starts a voice for each queued event. Audio thread.
+inline void sfxStartQueued(SfxMixer& sfx) {
+    uint32_t tail = sfx.tail.load(std::memory_order_relaxed);
+    uint32_t head = sfx.head.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+        const SfxEvent& event = sfx.events[tail & (SFX_QUEUE_SIZE - 1)];
+        // A free voice, or else the one with the least left to play.
+        SfxVoice* voice = nullptr;
+        size_t leastLeft = SIZE_MAX;
+        for (SfxVoice& v : sfx.voices) {
+            if (!v.clip) {
+                voice = &v;
+                break;
+            }
+            size_t left = v.clip->size() - v.position;
+            if (left < leastLeft) {
+                leastLeft = left;
+                voice = &v;
+            }
+        }
+        if (voice->clip)
+            sfx.stolen++;
+        voice->clip = &sfx.clips[event.id];
+        voice->position = 0;
+        voice->gain = event.gain;
+    }
+    sfx.tail.store(tail, std::memory_order_release);
+}
+
+// mix[0, frames) += gain * clip[0, frames).
+inline void sfxAccumulate(float* mix, const float* clip, int frames, float gain) {
+    int i = 0;
+#ifdef SFX_SSE
+    __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= frames; i += 4)
+        _mm_store_ps(mix + i, _mm_add_ps(_mm_load_ps(mix + i), _mm_mul_ps(_mm_loadu_ps(clip + i), g)));
+#endif
+    for (; i < frames; i++)
+        mix[i] += clip[i] * gain;
+}
+
+// out (interleaved 16-bit) += mix in every channel, saturating.
+inline void sfxAddToOutput(int16_t* out, const float* mix, int frames, int channels) {
+    int i = 0;
+#ifdef SFX_SSE
+    if (channels == 2) {
+        __m128 scale = _mm_set1_ps(32767.0f);
+        for (; i + 4 <= frames; i += 4) {
+            __m128i m = _mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(mix + i), scale));
+            __m128i lo = _mm_unpacklo_epi32(m, m), hi = _mm_unpackhi_epi32(m, m); // L and R of 4 frames.
+            __m128i existing = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i * 2));
+            __m128i existingLo = _mm_srai_epi32(_mm_unpacklo_epi16(existing, existing), 16);
+            __m128i existingHi = _mm_srai_epi32(_mm_unpackhi_epi16(existing, existing), 16);
+            __m128i sum = _mm_packs_epi32(_mm_add_epi32(existingLo, lo), _mm_add_epi32(existingHi, hi));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), sum);
+        }
+    }
+#endif
+    for (; i < frames; i++) {
+        int sample = static_cast<int>(std::lrint(mix[i] * 32767.0f));
+        for (int c = 0; c < channels; c++) {
+            int16_t& o = out[i * channels + c];
+            o = static_cast<int16_t>(std::min(32767, std::max(-32768, o + sample)));
+        }
+    }
+}
+
+// Adds the active voices to frames of interleaved 16-bit output. Audio thread.
+inline void sfxMix(SfxMixer& sfx, int16_t* out, int frames) {
+    sfxStartQueued(sfx);
+    while (frames > 0) {
+        int n = std::min(frames, SFX_MIX_FRAMES);
+        bool any = false;
+        for (SfxVoice& v : sfx.voices) {
+            if (!v.clip)
+                continue;
+            if (!any)
+                std::fill(sfx.mix, sfx.mix + n, 0.0f);
+            any = true;
+            int count = static_cast<int>(std::min<size_t>(n, v.clip->size() - v.position));
+            sfxAccumulate(sfx.mix, v.clip->data() + v.position, count, v.gain);
+            v.position += count;
+            if (v.position == v.clip->size())
+                v.clip = nullptr;
+        }
+        if (!any)
+            return;
+        sfxAddToOutput(out, sfx.mix, n, sfx.channels);
+        out += n * sfx.channels;
+        frames -= n;
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Procedural shapes built once instead of every frame. The heart is stored in
+// unit space at a fixed tessellation and only translated and scaled when drawn;
+// each bush obstacle's blobs are kept in obstacle-local space and rebuilt only
+// when the simulation rerolls them (GameSim::bushVersion).
+#ifndef SHAPE_CACHE_H
+#define SHAPE_CACHE_H
+
+#include "game_sim.h"
+
+#include <cmath>
+#include <vector>
+
+const int HEART_SEGMENTS = 96;
+const int BUSH_BLOB_SEGMENTS = 20;
+
+struct BushMesh {
+    unsigned int version = 0;
+    bool built = false;
+    float xy[5][2 * BUSH_BLOB_SEGMENTS];
+    float green[5];
+};
+
+struct ShapeCache {
+    std::vector<float> heart;              // Interleaved x,y of the size-1 heart.
+    float unitCircle[2 * BUSH_BLOB_SEGMENTS];
+    BushMesh bushes[SIM_NUM_OBSTACLES];
+    int bushRebuilds = 0;
+};
+
+inline void shapeCacheInit(ShapeCache& cache, int heartSegments = HEART_SEGMENTS) {
+    cache.heart.clear();
+    for (int i = 0; i < heartSegments; i++) {
+        float angle = i * 2 * 3.14159f / heartSegments;
+        cache.heart.push_back(16 * pow(sin(angle), 3));
+        cache.heart.push_back(13 * cos(angle) - 5 * cos(2 * angle) - 2 * cos(3 * angle) - cos(4 * angle));
+    }
+    for (int j = 0; j < BUSH_BLOB_SEGMENTS; j++) {
+        float theta = j * 2.0f * 3.14159f / BUSH_BLOB_SEGMENTS;
+        cache.unitCircle[2 * j] = cos(theta);
+        cache.unitCircle[2 * j + 1] = sin(theta);
+    }
+    for (BushMesh& mesh : cache.bushes)
+        mesh.built = false;
+}
+
+inline int shapeCacheHeartPoints(const ShapeCache& cache) {
+    return static_cast<int>(cache.heart.size() / 2);
+}
+
+// Blobs of obstacle i around (0, 0), rebuilt if the simulation changed them.
+inline const BushMesh& shapeCacheBush(ShapeCache& cache, const GameSim& sim, int i) {
+    BushMesh& mesh = cache.bushes[i];
+    if (mesh.built && mesh.version == sim.bushVersion[i])
+        return mesh;
+    const BushBlob& blob = sim.bushBlobs[i];
+    for (int b = 0; b < 5; b++) {
+        for (int j = 0; j < BUSH_BLOB_SEGMENTS; j++) {
+            mesh.xy[b][2 * j] = blob.offsetX[b] + cache.unitCircle[2 * j] * blob.radius[b];
+            mesh.xy[b][2 * j + 1] = blob.offsetY[b] + cache.unitCircle[2 * j + 1] * blob.radius[b];
+        }
+        mesh.green[b] = blob.green[b];
+    }
+    mesh.version = sim.bushVersion[i];
+    mesh.built = true;
+    cache.bushRebuilds++;
+    return mesh;
+}
+
+#endif
@@ -0,0 +1,98 @@
+// Scripted players for the headless tools. A bot looks at a GameSim before each
+// tick and returns the lane change it wants: -1 (left), 0 (stay) or 1 (right).
+#ifndef SIM_BOTS_H
+#define SIM_BOTS_H
+
+#include "game_sim.h"
+
+#include <cstring>
+
+enum BotPolicy {
+    BOT_IDLE,   // Never steers.
+    BOT_RANDOM, // Steers a random direction with probability steerChance per tick.
+    BOT_DODGE,  // Leaves its lane when an obstacle comes within reach, if a neighbour is clear.
+};
+
+// A human-like reaction delay: 250 ms at SIM_TICK_RATE. With none, dodge
+// never misses until the obstacles move faster per tick than the collision
+// window is tall and pass through the car.
+const int BOT_REACTION_TICKS = 15;
+
+struct BotConfig {
+    BotPolicy policy = BOT_RANDOM;
+    float steerChance = 0.02f; // BOT_RANDOM.
+    int reach = 150;           // BOT_DODGE: how far ahead of the car it looks, in pixels.
+    float missChance = 0.0f;   // BOT_DODGE: chance per tick to not look at all.
+    int reactionTicks = BOT_REACTION_TICKS; // BOT_DODGE: ticks from an obstacle coming into reach to steering away.
+};
+
+// Parses "idle", "random" or "dodge". Returns false on an unknown name.
+inline bool botPolicyFromName(const char* name, BotPolicy& policy) {
+    if (strcmp(name, "idle") == 0)
+        policy = BOT_IDLE;
+    else if (strcmp(name, "random") == 0)
+        policy = BOT_RANDOM;
+    else if (strcmp(name, "dodge") == 0)
+        policy = BOT_DODGE;
+    else
+        return false;
+    return true;
+}
+
+inline const char* botPolicyName(BotPolicy policy) {
+    switch (policy) {
+        case BOT_IDLE: return "idle";
+        case BOT_RANDOM: return "random";
+        case BOT_DODGE: return "dodge";
+    }
+    return "unknown";
+}
+
+// True if an obstacle in lane is between the car and reach pixels ahead of it.
+inline bool botLaneBlocked(const GameSim& sim, int lane, int reach) {
+    for (int i = 0; i < SIM_NUM_OBSTACLES; i++) {
+        if (sim.ovehicleX[i] == sim.lanes[lane] &&
+            sim.ovehicleY[i] > sim.vehicleY - 40 && sim.ovehicleY[i] < sim.vehicleY + reach)
+            return true;
+    }
+    return false;
+}
+
+// Uniform float in [0, 1) for the probability checks below.
+inline float botChance(SimRng& rng) {
+    return (rngNext(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// rng is the bot's own stream, separate from the game's, so bots never perturb spawning.
+inline int botChooseSteer(const BotConfig& config, const GameSim& sim, SimRng& rng) {
+    switch (config.policy) {
+        case BOT_IDLE:
+            return 0;
+        case BOT_RANDOM:
+            if (botChance(rng) < config.steerChance)
+                return (rngNext(rng) & 1) ? 1 : -1;
+            return 0;
+        case BOT_DODGE: {
+            if (config.missChance > 0 && botChance(rng) < config.missChance)
+                return 0;
+            // An obstacle that came into reach reactionTicks ago has since
+            // closed in by that many ticks of movement; only then does it count.
+            int closing = config.reactionTicks * simObstacleStep(sim);
+            int lane = sim.currentLaneIndex;
+            if (!botLaneBlocked(sim, lane, config.reach - closing))
+                return 0;
+            // Try a random side first so the bot has no lane bias.
+            int first = (rngNext(rng) & 1) ? 1 : -1;
+            for (int k = 0; k < 2; k++) {
+                int dir = k == 0 ? first : -first;
+                int target = lane + dir;
+                if (target >= 0 && target < SIM_NUM_LANES && !botLaneBlocked(sim, target, config.reach))
+                    return dir;
+            }
+            return 0;
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,197 @@
+// Sprite atlas for the shipped PNGs. Every sprite is decoded, trimmed,
+// Lanczos-resampled to the size it is drawn at (spriteFootprints) and
+// shelf-packed into one RGBA image with a full mip chain, so the whole PLAYING
+// screen can be drawn with a single bound texture. This part is CPU-only; the
+// game uploads the finished image itself.
+//
+// Include after stb_image.h. It is not included here because the game's copy
+// defines STB_IMAGE_IMPLEMENTATION, and stb_image.h cannot be included twice
+// in that mode.
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include "image_resample.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+enum SpriteId {
+    SPRITE_CAR,
+    SPRITE_BUSH,
+    SPRITE_ROCK,
+    SPRITE_POTHOLE,
+    SPRITE_HEART,
+    SPRITE_COUNT
+};
+
+const char* const spriteFiles[SPRITE_COUNT] = {
+    "car.png", "bush.png", "rock.png", "pothole.png", "heart.png"
+};
+
+// Part of each source image to keep, as fractions (left, top, right, bottom).
+// car.png is drawn on an opaque backdrop, so it is cut down to the car itself;
+// the others have transparent margins that loadSprite() trims on its own.
+const float spriteCrops[SPRITE_COUNT][4] = {
+    {0.23f, 0.04f, 0.77f, 0.96f}, {0, 0, 1, 1}, {0, 0, 1, 1}, {0, 0, 1, 1}, {0, 0, 1, 1}
+};
+
+// Longest side of the box each sprite is drawn in, in screen pixels; sprites
+// are packed at this size. Keep in step with the drawSprite() calls.
+const int spriteFootprints[SPRITE_COUNT] = {60, 50, 50, 50, 36};
+
+const int ATLAS_WIDTH = 256;
+// Gap between sprites so filtering does not bleed. Mip levels past the second
+// do bleed a little, but are only sampled for sprites drawn at under a
+// quarter of their footprint, which the game never does.
+const int ATLAS_PADDING = 4;
+const int SPRITE_TRIM_ALPHA = 16;  // Border pixels fainter than this are trimmed away.
+
+// Where a sprite sits in the atlas. vTop is the image's top row; texture rows
+// are uploaded top row first, so vTop < vBottom.
+struct AtlasRegion {
+    int x, y, width, height;
+    float u0, vTop, u1, vBottom;
+};
+
+struct AtlasImage {
+    int width = 0, height = 0;
+    std::vector<uint8_t> pixels; // RGBA, top row first.
+    std::vector<RgbaImage> mips; // Levels 1 and down; empty until buildAtlasMips().
+    AtlasRegion regions[SPRITE_COUNT];
+    // Decoded size of each source PNG, for printAtlasMemory(); 0 if unknown.
+    int sourceWidth[SPRITE_COUNT] = {}, sourceHeight[SPRITE_COUNT] = {};
+};
+
+// Region for the pixel rectangle (x, y, width, height) of an atlas of the given size.
+inline AtlasRegion atlasRegion(int x, int y, int width, int height, int atlasWidth, int atlasHeight) {
+    return {x, y, width, height,
+            float(x) / atlasWidth, float(y) / atlasHeight,
+            float(x + width) / atlasWidth, float(y + height) / atlasHeight};
+}
+
+// Keeps the crop window of a decoded RGBA image minus any near-transparent
+// border, and resamples the rest to fit maxSize on its longest side.
+inline RgbaImage processSprite(const uint8_t* image, int width, int height, const float (&crop)[4], int maxSize) {
+    int left = static_cast<int>(crop[0] * width), right = static_cast<int>(crop[2] * width);
+    int top = static_cast<int>(crop[1] * height), bottom = static_cast<int>(crop[3] * height);
+    int minX = right, maxX = left - 1, minY = bottom, maxY = top - 1;
+    for (int y = top; y < bottom; y++) {
+        for (int x = left; x < right; x++) {
+            if (image[(static_cast<size_t>(y) * width + x) * 4 + 3] < SPRITE_TRIM_ALPHA)
+                continue;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        }
+    }
+    if (maxX < minX) {
+        // Nothing visible; keep the window as is.
+        minX = left, maxX = right - 1, minY = top, maxY = bottom - 1;
+    }
+    int cropWidth = maxX - minX + 1, cropHeight = maxY - minY + 1;
+    float scale = std::min(1.0f, float(maxSize) / std::max(cropWidth, cropHeight));
+    int w = std::max(1, static_cast<int>(cropWidth * scale + 0.5f));
+    int h = std::max(1, static_cast<int>(cropHeight * scale + 0.5f));
+    return lanczosResample(image + (static_cast<size_t>(minY) * width + minX) * 4, width, cropWidth, cropHeight, w, h);
+}
+
+// Loads a sprite file and runs processSprite() on it. The decoded file's size
+// goes to sourceWidth/sourceHeight if given.
+inline bool loadSprite(const char* filename, const float (&crop)[4], int maxSize, RgbaImage& sprite,
+                       int* sourceWidth = nullptr, int* sourceHeight = nullptr) {
+    int width, height, channels;
+    unsigned char* image = stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
+    if (!image) {
+        std::cerr << "Failed to load image: " << filename << std::endl;
+        return false;
+    }
+    sprite = processSprite(image, width, height, crop, maxSize);
+    stbi_image_free(image);
+    if (sourceWidth)
+        *sourceWidth = width;
+    if (sourceHeight)
+        *sourceHeight = height;
+    return true;
+}
+
+// Shelf-packs already-loaded sprites, tallest first, into atlas.
+inline void packAtlas(const RgbaImage (&sprites)[SPRITE_COUNT], AtlasImage& atlas) {
+    int order[SPRITE_COUNT];
+    for (int i = 0; i < SPRITE_COUNT; i++)
+        order[i] = i;
+    std::sort(order, order + SPRITE_COUNT, [&](int a, int b) { return sprites[a].height > sprites[b].height; });
+
+    int x = ATLAS_PADDING, y = ATLAS_PADDING, shelfHeight = 0;
+    for (int k = 0; k < SPRITE_COUNT; k++) {
+        const RgbaImage& s = sprites[order[k]];
+        if (x + s.width + ATLAS_PADDING > ATLAS_WIDTH) {
+            x = ATLAS_PADDING;
+            y += shelfHeight + ATLAS_PADDING;
+            shelfHeight = 0;
+        }
+        atlas.regions[order[k]] = {x, y, s.width, s.height, 0, 0, 0, 0};
+        x += s.width + ATLAS_PADDING;
+        shelfHeight = std::max(shelfHeight, s.height);
+    }
+    int used = y + shelfHeight + ATLAS_PADDING;
+    atlas.width = ATLAS_WIDTH;
+    atlas.height = 1;
+    while (atlas.height < used)
+        atlas.height *= 2;
+
+    atlas.pixels.assign(static_cast<size_t>(atlas.width) * atlas.height * 4, 0);
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        AtlasRegion& r = atlas.regions[i];
+        for (int row = 0; row < r.height; row++)
+            std::copy_n(&sprites[i].pixels[static_cast<size_t>(row) * r.width * 4], r.width * 4,
+                        &atlas.pixels[(static_cast<size_t>(r.y + row) * atlas.width + r.x) * 4]);
+        r = atlasRegion(r.x, r.y, r.width, r.height, atlas.width, atlas.height);
+    }
+}
+
+inline void buildAtlasMips(AtlasImage& atlas) {
+    atlas.mips = buildMipChain(atlas.pixels.data(), atlas.width, atlas.height);
+}
+
+// Loads every sprite in spriteFiles, packs them and builds the mip chain.
+// Returns false if any is missing.
+inline bool buildAtlas(AtlasImage& atlas) {
+    RgbaImage sprites[SPRITE_COUNT];
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        if (!loadSprite(spriteFiles[i], spriteCrops[i], spriteFootprints[i], sprites[i],
+                        &atlas.sourceWidth[i], &atlas.sourceHeight[i]))
+            return false;
+    }
+    packAtlas(sprites, atlas);
+    buildAtlasMips(atlas);
+    return true;
+}
+
+// Prints each sprite's decoded PNG size against its share of the atlas as
+// uploaded, mip levels included, and the totals.
+inline void printAtlasMemory(const AtlasImage& atlas) {
+    double levelZero = double(atlas.width) * atlas.height * 4;
+    double uploaded = levelZero;
+    for (const RgbaImage& mip : atlas.mips)
+        uploaded += imageBytes(mip);
+    double mipFactor = uploaded / levelZero;
+    double sources = 0;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        const AtlasRegion& r = atlas.regions[i];
+        double source = double(atlas.sourceWidth[i]) * atlas.sourceHeight[i] * 4;
+        double share = double(r.width) * r.height * 4 * mipFactor;
+        sources += source;
+        printf("  %-16s %4dx%-4d %8.1f KB -> %3dx%-3d %6.1f KB (%.1f%% saved)\n", spriteFiles[i],
+               atlas.sourceWidth[i], atlas.sourceHeight[i], source / 1024, r.width, r.height, share / 1024,
+               source > 0 ? 100 * (1 - share / source) : 0.0);
+    }
+    printf("  atlas %dx%d, %d levels: %.1f KB uploaded for %.1f KB of decoded PNGs (%.1f%% saved)\n",
+           atlas.width, atlas.height, 1 + static_cast<int>(atlas.mips.size()), uploaded / 1024, sources / 1024,
+           sources > 0 ? 100 * (1 - uploaded / sources) : 0.0);
+}
+
+#endif
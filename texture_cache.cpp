@@ -0,0 +1,133 @@
+// Maintains the on-disk cache of processed sprites (texture_cache.h) that the
+// game reads instead of decoding the PNGs.
+//
+// Build: g++ -O2 -std=c++17 texture_cache.cpp -o texture_cache
+// Usage: texture_cache warm|list|purge [--dir DIR] [--stale]
+//
+// warm   decodes every sprite the game loads into the cache, so the first
+//        launch after an art change is as fast as the rest.
+// list   prints each entry, marking the ones the current PNGs still use.
+// purge  deletes every entry, or with --stale only those no current PNG uses.
+//        Entries are never invalidated in place, so this is how old ones go.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "texture_cache.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <chrono>
+
+#include <dirent.h>
+
+// Paths of the entries the current sprite PNGs map to.
+std::set<std::string> liveEntries(const char* directory) {
+    std::set<std::string> live;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        std::vector<uint8_t> source;
+        if (readWholeFile(spriteFiles[i], source))
+            live.insert(textureCachePath(directory, spriteCacheKey(source, spriteCrops[i], spriteFootprints[i])));
+    }
+    return live;
+}
+
+std::vector<std::string> cacheEntries(const char* directory) {
+    std::vector<std::string> entries;
+    DIR* dir = opendir(directory);
+    if (!dir)
+        return entries;
+    size_t suffixLength = strlen(TEXTURE_CACHE_SUFFIX);
+    while (dirent* entry = readdir(dir)) {
+        size_t length = strlen(entry->d_name);
+        if (length > suffixLength && strcmp(entry->d_name + length - suffixLength, TEXTURE_CACHE_SUFFIX) == 0)
+            entries.push_back(std::string(directory) + "/" + entry->d_name);
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+int warm(const char* directory) {
+    int failed = 0;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        auto start = std::chrono::steady_clock::now();
+        RgbaImage sprite;
+        bool hit;
+        if (!loadSpriteCached(directory, spriteFiles[i], spriteCrops[i], spriteFootprints[i], sprite,
+                              nullptr, nullptr, &hit)) {
+            failed++;
+            continue;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%-20s %3dx%-3d %-6s %.2f ms\n", spriteFiles[i], sprite.width, sprite.height,
+               hit ? "cached" : "added", ms);
+    }
+    return failed ? 1 : 0;
+}
+
+int list(const char* directory) {
+    std::set<std::string> live = liveEntries(directory);
+    size_t totalBytes = 0;
+    std::vector<std::string> entries = cacheEntries(directory);
+    for (const std::string& path : entries) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+        totalBytes += st.st_size;
+        printf("%s %8.1f KB %s\n", path.c_str(), st.st_size / 1024.0, live.count(path) ? "" : "stale");
+    }
+    printf("%zu entries, %.1f KB\n", entries.size(), totalBytes / 1024.0);
+    return 0;
+}
+
+int purge(const char* directory, bool staleOnly) {
+    std::set<std::string> live;
+    if (staleOnly)
+        live = liveEntries(directory);
+    int removed = 0;
+    for (const std::string& path : cacheEntries(directory)) {
+        if (live.count(path))
+            continue;
+        if (remove(path.c_str()) == 0)
+            removed++;
+        else
+            std::cerr << "Failed to remove " << path << std::endl;
+    }
+    printf("Removed %d entries from %s\n", removed, directory);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* command = nullptr;
+    const char* directory = ".texture_cache";
+    bool staleOnly = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            directory = argv[++i];
+        } else if (strcmp(argv[i], "--stale") == 0) {
+            staleOnly = true;
+        } else if (!command && (strcmp(argv[i], "warm") == 0 || strcmp(argv[i], "list") == 0 ||
+                                strcmp(argv[i], "purge") == 0)) {
+            command = argv[i];
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (!command) {
+        std::cerr << "Usage: texture_cache warm|list|purge [--dir DIR] [--stale]" << std::endl;
+        return 1;
+    }
+
+    if (strcmp(command, "warm") == 0)
+        return warm(directory);
+    if (strcmp(command, "list") == 0)
+        return list(directory);
+    return purge(directory, staleOnly);
+}
@@ -0,0 +1,164 @@
+// On-disk cache of processed sprites (decoded, trimmed and resampled; see
+// texture_atlas.h). Entries are content addressed: the file name is a hash of
+// the source PNG's bytes plus every parameter that shapes the output, so an
+// edited PNG or a changed footprint simply misses and writes a new entry, and
+// nothing ever needs invalidating by hand. A hit costs reading and hashing the
+// PNG plus one mmap, with no inflate or resample.
+//
+// Entry layout: TextureCacheHeader, then width * height RGBA pixels.
+// Include after stb_image.h, like texture_atlas.h.
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "texture_atlas.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint32_t TEXTURE_CACHE_MAGIC = 0x58455443; // "CTEX" read as a little-endian word.
+// Bump when processSprite() or the resampler changes output, so old entries miss.
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+const char* const TEXTURE_CACHE_SUFFIX = ".tex";
+
+struct TextureCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t width, height;             // Processed sprite.
+    int32_t sourceWidth, sourceHeight; // Decoded PNG.
+};
+
+inline uint64_t cacheHashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Cache key for a sprite: FNV-1a over the source bytes and the processing parameters.
+inline uint64_t spriteCacheKey(const std::vector<uint8_t>& source, const float (&crop)[4], int maxSize) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = cacheHashBytes(hash, source.data(), source.size());
+    hash = cacheHashBytes(hash, crop, sizeof(crop));
+    hash = cacheHashBytes(hash, &maxSize, sizeof(maxSize));
+    hash = cacheHashBytes(hash, &SPRITE_TRIM_ALPHA, sizeof(SPRITE_TRIM_ALPHA));
+    hash = cacheHashBytes(hash, &TEXTURE_CACHE_VERSION, sizeof(TEXTURE_CACHE_VERSION));
+    return hash;
+}
+
+inline std::string textureCachePath(const char* directory, uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return std::string(directory) + "/" + name + TEXTURE_CACHE_SUFFIX;
+}
+
+inline bool readWholeFile(const char* filename, std::vector<uint8_t>& bytes) {
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    bytes.resize(size > 0 ? size : 0);
+    bool ok = size >= 0 && fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+    return ok;
+}
+
+// Maps the entry at path into sprite. False if it is missing or malformed.
+inline bool textureCacheRead(const std::string& path, RgbaImage& sprite, int* sourceWidth, int* sourceHeight) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(TextureCacheHeader)))
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    const TextureCacheHeader& h = *static_cast<const TextureCacheHeader*>(data);
+    size_t pixelBytes = static_cast<size_t>(h.width) * h.height * 4;
+    bool ok = h.magic == TEXTURE_CACHE_MAGIC && h.version == TEXTURE_CACHE_VERSION && h.width > 0 &&
+              h.height > 0 && sizeof(h) + pixelBytes == static_cast<size_t>(st.st_size);
+    if (ok) {
+        const uint8_t* pixels = static_cast<const uint8_t*>(data) + sizeof(h);
+        sprite.width = h.width;
+        sprite.height = h.height;
+        sprite.pixels.assign(pixels, pixels + pixelBytes);
+        if (sourceWidth)
+            *sourceWidth = h.sourceWidth;
+        if (sourceHeight)
+            *sourceHeight = h.sourceHeight;
+    }
+    munmap(data, st.st_size);
+    return ok;
+}
+
+// Writes an entry under a temporary name and renames it into place, so a
+// reader never sees half an entry even with several writers.
+inline bool textureCacheWrite(const std::string& path, const RgbaImage& sprite, int sourceWidth, int sourceHeight) {
+    std::string temp = path + "." + std::to_string(getpid()) + "." + std::to_string(reinterpret_cast<uintptr_t>(&sprite));
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file)
+        return false;
+    TextureCacheHeader h = {TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION, sprite.width, sprite.height,
+                            sourceWidth, sourceHeight};
+    bool ok = fwrite(&h, sizeof(h), 1, file) == 1 &&
+              fwrite(sprite.pixels.data(), 1, sprite.pixels.size(), file) == sprite.pixels.size();
+    ok = fclose(file) == 0 && ok;
+    if (ok)
+        ok = rename(temp.c_str(), path.c_str()) == 0;
+    if (!ok)
+        remove(temp.c_str());
+    return ok;
+}
+
+// loadSprite() through the cache in directory, which is created if needed.
+// Sets *hit to whether the entry was already there. A cache that cannot be
+// written only costs the speedup.
+inline bool loadSpriteCached(const char* directory, const char* filename, const float (&crop)[4], int maxSize,
+                             RgbaImage& sprite, int* sourceWidth = nullptr, int* sourceHeight = nullptr,
+                             bool* hit = nullptr) {
+    if (hit)
+        *hit = false;
+    std::vector<uint8_t> source;
+    if (!readWholeFile(filename, source)) {
+        std::cerr << "Failed to load image: " << filename << std::endl;
+        return false;
+    }
+    std::string path = textureCachePath(directory, spriteCacheKey(source, crop, maxSize));
+    if (textureCacheRead(path, sprite, sourceWidth, sourceHeight)) {
+        if (hit)
+            *hit = true;
+        return true;
+    }
+    int width, height, channels;
+    unsigned char* image = stbi_load_from_memory(source.data(), static_cast<int>(source.size()),
+                                                 &width, &height, &channels, STBI_rgb_alpha);
+    if (!image) {
+        std::cerr << "Failed to load image: " << filename << std::endl;
+        return false;
+    }
+    sprite = processSprite(image, width, height, crop, maxSize);
+    stbi_image_free(image);
+    if (sourceWidth)
+        *sourceWidth = width;
+    if (sourceHeight)
+        *sourceHeight = height;
+    mkdir(directory, 0755);
+    textureCacheWrite(path, sprite, width, height);
+    return true;
+}
+
+#endif
@@ -0,0 +1,82 @@
+// Texture uploads split across frames. textureAllocate() creates the storage
+// for every mip level up front; a TextureStream then copies the pixels in
+// with glTexSubImage2D, a byte budget's worth of rows per call, so a large
+// upload never stalls a single frame.
+#ifndef TEXTURE_STREAM_H
+#define TEXTURE_STREAM_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A linear-filtered RGBA texture with levelCount empty mip levels. Level i is
+// (width >> i) x (height >> i), at least 1x1.
+inline GLuint textureAllocate(int width, int height, int levelCount) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    for (int l = 0; l < levelCount; l++)
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA, std::max(1, width >> l), std::max(1, height >> l),
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+struct TextureStream {
+    GLuint texture = 0;
+    int width = 0, height = 0;
+    std::vector<const uint8_t*> levels; // Source pixels; must stay valid until the stream is done.
+    int level = 0, row = 0;              // Next rows to copy.
+};
+
+inline bool textureStreamDone(const TextureStream& stream) {
+    return stream.level >= static_cast<int>(stream.levels.size());
+}
+
+// Starts copying levels, top row first, into texture (from textureAllocate()).
+inline void textureStreamBegin(TextureStream& stream, GLuint texture, int width, int height,
+                               const std::vector<const uint8_t*>& levels) {
+    stream.texture = texture;
+    stream.width = width;
+    stream.height = height;
+    stream.levels = levels;
+    stream.level = 0;
+    stream.row = 0;
+}
+
+// Copies about budget bytes, at least one row. Returns true once every level is in.
+inline bool textureStreamStep(TextureStream& stream, size_t budget) {
+    if (textureStreamDone(stream))
+        return true;
+    glBindTexture(GL_TEXTURE_2D, stream.texture);
+    size_t sent = 0;
+    while (!textureStreamDone(stream) && sent < budget) {
+        int w = std::max(1, stream.width >> stream.level), h = std::max(1, stream.height >> stream.level);
+        size_t rowBytes = static_cast<size_t>(w) * 4;
+        int rows = static_cast<int>(std::min<size_t>(h - stream.row, std::max<size_t>(1, (budget - sent) / rowBytes)));
+        glTexSubImage2D(GL_TEXTURE_2D, stream.level, 0, stream.row, w, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                        stream.levels[stream.level] + stream.row * rowBytes);
+        sent += rows * rowBytes;
+        stream.row += rows;
+        if (stream.row == h) {
+            stream.level++;
+            stream.row = 0;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return textureStreamDone(stream);
+}
+
+#endif
@@ -0,0 +1,193 @@
+// Scoped trace markers written as a Chrome trace-event JSON file, which opens
+// in chrome://tracing or ui.perfetto.dev.
+//
+//   traceStart("car.trace.json");   // usually from a command-line flag
+//   { TRACE_SCOPE("drawGame"); ... }
+//   TRACE_INSTANT("engine sound start");
+//   TRACE_SCOPE_NAMED(startup, "startup"); ... TRACE_SCOPE_END(startup);
+//   traceStop();                    // flushes and closes the JSON array
+//
+// Each thread appends to its own lock-free ring, which a background thread
+// drains to disk every TRACE_FLUSH_MS. When tracing is off a marker costs one
+// relaxed atomic load; build with -DNO_TRACING to compile the markers out.
+// Event names must be string literals: only the pointer is stored.
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+const uint32_t TRACE_BUFFER_SIZE = 1 << 14; // Events per thread; must be a power of two.
+const int TRACE_FLUSH_MS = 100;
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start;     // Nanoseconds since traceStart().
+    uint64_t duration;  // Nanoseconds; unused for instant events.
+    char phase;         // 'X' complete event, 'i' instant event.
+};
+
+// Single-producer (owning thread) / single-consumer (flush thread) ring.
+struct TraceBuffer {
+    TraceEvent events[TRACE_BUFFER_SIZE];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    int tid = 0;
+};
+
+struct TraceState {
+    std::atomic<bool> enabled{false};
+    std::chrono::steady_clock::time_point origin;
+    FILE* file = nullptr;
+    bool firstEvent = true;
+    std::mutex registryMutex;            // Guards buffers and file.
+    std::vector<TraceBuffer*> buffers;
+    std::thread flusher;
+    std::mutex flushMutex;
+    std::condition_variable flushWake;
+    bool stopping = false;
+};
+
+inline TraceState& traceState() {
+    static TraceState state;
+    return state;
+}
+
+inline bool traceEnabled() {
+    return traceState().enabled.load(std::memory_order_relaxed);
+}
+
+inline uint64_t traceNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - traceState().origin).count();
+}
+
+// The calling thread's ring, created and registered on first use.
+inline TraceBuffer* traceThreadBuffer() {
+    static thread_local TraceBuffer* buffer = nullptr;
+    if (!buffer) {
+        TraceState& st = traceState();
+        buffer = new TraceBuffer;
+        std::lock_guard<std::mutex> lock(st.registryMutex);
+        buffer->tid = static_cast<int>(st.buffers.size()) + 1;
+        st.buffers.push_back(buffer);
+    }
+    return buffer;
+}
+
+inline void tracePush(const char* name, uint64_t start, uint64_t duration, char phase) {
+    TraceBuffer* b = traceThreadBuffer();
+    uint32_t h = b->head.load(std::memory_order_relaxed);
+    if (h - b->tail.load(std::memory_order_acquire) >= TRACE_BUFFER_SIZE) {
+        b->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    b->events[h & (TRACE_BUFFER_SIZE - 1)] = {name, start, duration, phase};
+    b->head.store(h + 1, std::memory_order_release);
+}
+
+// Writes every pending event to the file. Called from the flush thread and at stop.
+inline void traceFlush() {
+    TraceState& st = traceState();
+    std::lock_guard<std::mutex> lock(st.registryMutex);
+    for (TraceBuffer* b : st.buffers) {
+        uint32_t t = b->tail.load(std::memory_order_relaxed);
+        uint32_t h = b->head.load(std::memory_order_acquire);
+        for (; t != h; t++) {
+            const TraceEvent& e = b->events[t & (TRACE_BUFFER_SIZE - 1)];
+            fprintf(st.file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,", st.firstEvent ? "" : ",",
+                    e.name, e.phase, e.start / 1000.0);
+            if (e.phase == 'X')
+                fprintf(st.file, "\"dur\":%.3f,", e.duration / 1000.0);
+            else
+                fprintf(st.file, "\"s\":\"t\",");
+            fprintf(st.file, "\"pid\":1,\"tid\":%d}", b->tid);
+            st.firstEvent = false;
+        }
+        b->tail.store(t, std::memory_order_release);
+    }
+    fflush(st.file);
+}
+
+inline bool traceStart(const char* filename) {
+    TraceState& st = traceState();
+    st.file = fopen(filename, "w");
+    if (!st.file)
+        return false;
+    fprintf(st.file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    st.origin = std::chrono::steady_clock::now();
+    st.stopping = false;
+    st.flusher = std::thread([&st] {
+        std::unique_lock<std::mutex> lock(st.flushMutex);
+        while (!st.stopping) {
+            st.flushWake.wait_for(lock, std::chrono::milliseconds(TRACE_FLUSH_MS));
+            traceFlush();
+        }
+    });
+    st.enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+inline void traceStop() {
+    TraceState& st = traceState();
+    if (!st.enabled.exchange(false))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(st.flushMutex);
+        st.stopping = true;
+    }
+    st.flushWake.notify_all();
+    st.flusher.join();
+    traceFlush();
+    uint64_t dropped = 0;
+    for (TraceBuffer* b : st.buffers)
+        dropped += b->dropped.load();
+    fprintf(st.file, "\n],\"otherData\":{\"droppedEvents\":%llu}}\n", (unsigned long long)dropped);
+    fclose(st.file);
+    st.file = nullptr;
+}
+
+// Records a complete event spanning the lifetime of the object.
+struct TraceScope {
+    const char* name;
+    uint64_t start;
+    explicit TraceScope(const char* n) : name(traceEnabled() ? n : nullptr), start(name ? traceNow() : 0) {}
+    ~TraceScope() { end(); }
+    // Ends the event early, for scopes that never unwind.
+    void end() {
+        if (name && traceEnabled())
+            tracePush(name, start, traceNow() - start, 'X');
+        name = nullptr;
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+inline void traceInstant(const char* name) {
+    if (traceEnabled())
+        tracePush(name, traceNow(), 0, 'i');
+}
+
+#ifdef NO_TRACING
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_NAMED(var, name) ((void)0)
+#define TRACE_SCOPE_END(var) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#else
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+// A scope that can be ended early with TRACE_SCOPE_END(var), for scopes that never unwind.
+#define TRACE_SCOPE_NAMED(var, name) TraceScope var(name)
+#define TRACE_SCOPE_END(var) var.end()
+#define TRACE_INSTANT(name) traceInstant(name)
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+// Small work-stealing thread pool. Each worker owns a deque; tasks submitted
+// from a worker go to its own deque, others are spread round-robin. A worker
+// pops from the back of its own deque and, when that is empty, steals from the
+// front of someone else's.
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkPool {
+public:
+    explicit WorkPool(unsigned threads = 0) {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+        for (unsigned i = 0; i < threads; i++)
+            queues.emplace_back(new WorkerQueue);
+        for (unsigned i = 0; i < threads; i++)
+            workers.emplace_back([this, i] { run(i); });
+    }
+
+    ~WorkPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+    }
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    void submit(std::function<void()> task) {
+        int self = workerIndex();
+        unsigned target = self >= 0 ? static_cast<unsigned>(self)
+                                    : nextQueue.fetch_add(1, std::memory_order_relaxed) % size();
+        pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until every submitted task has finished. Must not be called from a worker.
+    void wait() {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        idle.wait(lock, [this] { return pending.load() == 0; });
+    }
+
+    // Index of the calling worker thread, or -1 when called from outside the pool.
+    static int& workerIndex() {
+        static thread_local int index = -1;
+        return index;
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool take(unsigned self, std::function<void()>& task) {
+        {
+            WorkerQueue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (unsigned k = 1; k < size(); k++) {
+            WorkerQueue& victim = *queues[(self + k) % size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(unsigned self) {
+        workerIndex() = static_cast<int>(self);
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wake.wait(lock, [this] { return stopping || queued > 0; });
+                if (stopping && queued == 0)
+                    return;
+                queued--;
+            }
+            // A task is reserved for us; it may sit in any queue, so keep looking until found.
+            std::function<void()> task;
+            while (!take(self, task))
+                std::this_thread::yield();
+            task();
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                idle.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> nextQueue{0};
+    std::atomic<size_t> pending{0}; // Submitted but not yet finished.
+    std::mutex sleepMutex;
+    std::condition_variable wake, idle;
+    size_t queued = 0;              // In a deque and not yet claimed; guarded by sleepMutex.
+    bool stopping = false;
+};
+
+#endif